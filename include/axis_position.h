@@ -0,0 +1,46 @@
+// include/axis_position.h
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#include "step_schedule.h"
+
+//—————————————————————————————————————————————
+// Axis Position Manager
+//
+// Signed 64-bit step positions relative to a settable origin. The step
+// generator is the only writer; any task may read. A 64-bit store is two
+// 32-bit stores on the ESP32, so updates are published through a sequence
+// counter and readers retry until they see a stable, even count.
+//—————————————————————————————————————————————
+
+class AxisPositions {
+ public:
+  // writer side — motion code only
+  inline void step(uint8_t mask, uint8_t dirBits) {
+    if (!mask) return;
+    writeBegin();
+    if (mask & AXIS1_BIT) pos_[0] = pos_[0] + ((dirBits & AXIS1_BIT) ? 1 : -1);
+    if (mask & AXIS2_BIT) pos_[1] = pos_[1] + ((dirBits & AXIS2_BIT) ? 1 : -1);
+    writeEnd();
+  }
+  void setOrigin();                          // current position becomes 0,0
+  void set(int64_t p1, int64_t p2);
+
+  // reader side — any task, never torn
+  void read(int64_t &p1, int64_t &p2) const;
+
+ private:
+  inline void writeBegin() {
+    seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+  inline void writeEnd() {
+    seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  std::atomic<uint32_t> seq_{0};
+  volatile int64_t      pos_[2] = { 0, 0 };
+};
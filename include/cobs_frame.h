@@ -0,0 +1,95 @@
+// include/cobs_frame.h
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "crc32.h"
+
+//—————————————————————————————————————————————
+// COBS Frames
+//
+// Binary messages share the serial port with text, so each one is sent
+// as 0x00, COBS(type, payload, CRC-32 little-endian), 0x00. COBS leaves
+// no zero bytes inside a frame: a receiver resynchronises at the next
+// delimiter, and any text that lands between frames fails the CRC and
+// is dropped as noise.
+//—————————————————————————————————————————————
+
+// type + payload + CRC, COBS overhead, two delimiters
+#define COBS_FRAME_MAX(payload)  ((payload) + 5 + ((payload) + 5) / 254 + 1 + 2)
+
+// byte-at-a-time stuffing into out, which needs n + n/254 + 1 bytes
+class CobsWriter {
+ public:
+  explicit CobsWriter(uint8_t *out) : out_(out) {}
+  void put(uint8_t b) {
+    if (b) {
+      out_[o_++] = b;
+      run_++;
+    }
+    if (!b || run_ == 0xFF) {
+      out_[code_] = run_;
+      code_ = o_++;
+      run_  = 1;
+    }
+  }
+  size_t finish() {
+    out_[code_] = run_;
+    return o_;
+  }
+
+ private:
+  uint8_t *out_;
+  size_t   o_    = 1;
+  size_t   code_ = 0;
+  uint8_t  run_  = 1;
+};
+
+inline size_t cobsEncode(const uint8_t *in, size_t len, uint8_t *out) {
+  CobsWriter w(out);
+  for (size_t i = 0; i < len; i++) w.put(in[i]);
+  return w.finish();
+}
+
+// unstuff one frame body (no delimiters); returns 0 if it is malformed
+inline size_t cobsDecode(const uint8_t *in, size_t len, uint8_t *out) {
+  size_t i = 0, o = 0;
+  while (i < len) {
+    uint8_t run = in[i++];
+    if (!run || i + run - 1 > len) return 0;
+    for (uint8_t k = 1; k < run; k++) {
+      if (!in[i]) return 0;
+      out[o++] = in[i++];
+    }
+    if (run != 0xFF && i < len) out[o++] = 0;
+  }
+  return o;
+}
+
+// a whole frame, delimiters included; returns its length
+inline size_t frameEncode(uint8_t type, const uint8_t *payload, size_t len, uint8_t *out) {
+  uint32_t crc = crc32Update(crc32(&type, 1), payload, len);
+  out[0] = 0;
+  CobsWriter w(out + 1);
+  w.put(type);
+  for (size_t i = 0; i < len; i++) w.put(payload[i]);
+  for (int b = 0; b < 4; b++) w.put((uint8_t)(crc >> (8 * b)));
+  size_t n = w.finish();
+  out[1 + n] = 0;
+  return n + 2;
+}
+
+// check a frame body between delimiters; on success buf holds type and
+// payload, and len is the payload length
+inline bool frameDecode(const uint8_t *in, size_t n, uint8_t *buf, uint8_t &type,
+                        size_t &len) {
+  size_t m = cobsDecode(in, n, buf);
+  if (m < 5) return false;
+  uint32_t crc = 0;
+  for (int b = 0; b < 4; b++) crc |= (uint32_t)buf[m - 4 + b] << (8 * b);
+  if (crc != crc32(buf, m - 4)) return false;
+  type = buf[0];
+  len  = m - 5;
+  return true;
+}
@@ -0,0 +1,121 @@
+// include/command_protocol.h
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cobs_frame.h"
+#include "segment.h"
+
+//—————————————————————————————————————————————
+// Serial Command Protocol
+//
+// Host commands arrive as COBS frames (cobs_frame.h) on the same port as
+// the text output and the single-letter commands. Every command payload
+// starts with a sequence byte; the reply has type | CMD_REPLY and carries
+// that byte back, then a CommandStatus, then any data. Multi-byte fields
+// are little-endian.
+//
+// Streaming runs live segments through a SEGMENT_QUEUE_LEN queue with
+// credit-based flow control: every STREAM_* reply and every EVT_STREAM
+// (sent as segments finish) reports the free slots, and the host keeps
+// at most that many segments in flight. A G-code stream works the same
+// way over a MOVE_QUEUE_LEN queue of planner moves: GCODE frames carry
+// program text, each '\n' is one credit, and a line may straddle frames.
+// Bytes outside frames are handed back as text.
+//—————————————————————————————————————————————
+
+#define PROTOCOL_VERSION       2
+#define CMD_REPLY              0x80
+#define EVT_STREAM             0x53    // unsolicited: stream credits / state
+#define SEGMENT_WIRE_BYTES     14      // dir1 dir2 pulses1 pulses2 durationMs
+#define COMMAND_SEGMENTS_MAX   8       // segments per UPLOAD/DOWNLOAD/PUSH frame
+#define COMMAND_PAYLOAD_MAX    (8 + COMMAND_SEGMENTS_MAX * SEGMENT_WIRE_BYTES)
+
+enum CommandType : uint8_t {
+  CMD_PING         = 0x01,   // → version u8, MAX_SEGMENTS u16, queue u8, segs/frame u8,
+                             //   move queue u8
+  CMD_STATUS       = 0x02,   // → flags u16, pos1 i32, pos2 i32, segments u16,
+                             //   queued u8, credits u8, completed u32, underruns u32
+  CMD_LIST         = 0x03,   // → RAM count u16, stamp u32, flash count u16, stamp u32
+  CMD_UPLOAD       = 0x04,   // save u8, total u16, offset u16, n u8, n segments
+                             //   → received u16
+  CMD_DOWNLOAD     = 0x05,   // offset u16, n u8 → total u16, offset u16, n u8, segments
+  CMD_DELETE       = 0x06,   // recording in RAM and flash
+  CMD_PLAY         = 0x07,   // reverse u8
+  CMD_STOP         = 0x08,   // wind down whatever is running
+  CMD_STREAM_BEGIN = 0x09,   // [mode u8: 0 segments, 1 G-code] → credits u8
+  CMD_STREAM_PUSH  = 0x0A,   // n u8, n segments → credits u8 (all or none taken)
+  CMD_STREAM_END   = 0x0B,   // finish once the queue drains → credits u8
+  CMD_GCODE        = 0x0C,   // program text → credits u8, GcodeError u8, line u32
+                             //   (first bad line in the frame; it is skipped)
+};
+
+enum CommandStatus : uint8_t {
+  ST_OK       = 0,
+  ST_BAD      = 1,   // malformed payload
+  ST_BUSY     = 2,   // not while moving or recording
+  ST_RANGE    = 3,   // offset/count out of range, or upload out of order
+  ST_FULL     = 4,   // push larger than the credits on offer
+  ST_UNKNOWN  = 5,   // no such command
+  ST_STATE    = 6,   // no stream of that kind running / nothing recorded
+};
+
+// EVT_STREAM payload: credits u8, completed u32, underruns u32, StreamState u8
+enum StreamState : uint8_t { STREAM_RUNNING = 0, STREAM_DONE = 1, STREAM_ABORTED = 2 };
+
+// bounds-checked little-endian payload writer; ok() turns false on overrun
+class WireOut {
+ public:
+  WireOut(uint8_t *buf, size_t cap) : p_(buf), start_(buf), end_(buf + cap) {}
+  void   u8(uint8_t v)   { if (room(1)) *p_++ = v; }
+  void   u16(uint16_t v) { for (int b = 0; b < 2; b++) u8((uint8_t)(v >> (8 * b))); }
+  void   u32(uint32_t v) { for (int b = 0; b < 4; b++) u8((uint8_t)(v >> (8 * b))); }
+  void   segment(const Segment &s);
+  size_t len() const     { return (size_t)(p_ - start_); }
+  bool   ok() const      { return ok_; }
+
+ private:
+  bool room(size_t n) { if (p_ + n > end_) ok_ = false; return ok_; }
+  uint8_t *p_, *start_, *end_;
+  bool     ok_ = true;
+};
+
+// reader for the same layout; reads past the end yield 0 and clear ok()
+class WireIn {
+ public:
+  WireIn(const uint8_t *buf, size_t len) : p_(buf), end_(buf + len) {}
+  uint8_t  u8()          { if (p_ >= end_) { ok_ = false; return 0; } return *p_++; }
+  uint16_t u16()         { uint16_t v = u8(); return v | (uint16_t)(u8() << 8); }
+  uint32_t u32()         { uint32_t v = 0; for (int b = 0; b < 4; b++) v |= (uint32_t)u8() << (8 * b); return v; }
+  Segment  segment();
+  size_t   left() const  { return (size_t)(end_ - p_); }
+  bool     ok() const    { return ok_; }
+
+ private:
+  const uint8_t *p_, *end_;
+  bool           ok_ = true;
+};
+
+// splits the serial byte stream into frames and text
+enum RxResult : uint8_t { RX_NONE, RX_TEXT, RX_FRAME };
+
+class FrameReader {
+ public:
+  // RX_TEXT: b is a text byte; RX_FRAME: a frame checked out, see below
+  RxResult feed(uint8_t b);
+  uint8_t        type() const    { return buf_[0]; }
+  const uint8_t *payload() const { return buf_ + 1; }
+  size_t         len() const     { return len_; }
+  uint32_t       errors() const  { return errors_; }   // bad CRC, bad COBS, too long
+
+ private:
+  static const size_t RAW_MAX = COBS_FRAME_MAX(COMMAND_PAYLOAD_MAX);
+  uint8_t  raw_[RAW_MAX];
+  uint8_t  buf_[RAW_MAX];
+  size_t   n_       = 0;
+  size_t   len_     = 0;
+  bool     inFrame_ = false;
+  bool     over_    = false;
+  uint32_t errors_  = 0;
+};
@@ -0,0 +1,71 @@
+// include/controller_input.h
+
+#pragma once
+
+#include <stdint.h>
+
+//—————————————————————————————————————————————
+// Controller Input Layer
+//
+// Every poll packs the buttons into one word; press and release edges are
+// a single XOR against the previous word and are dispatched, in button
+// order, through a handler table. Each frame carries its receipt time so
+// later stages can measure latency. Nothing here touches the controller
+// library, so a host build can replay recorded frames through it.
+//—————————————————————————————————————————————
+
+// bit positions; dispatch runs low bit first
+enum InputButton : uint8_t {
+  BTN_LB, BTN_RB, BTN_BACK, BTN_START,
+  BTN_A, BTN_B, BTN_X, BTN_Y,
+  BTN_UP, BTN_RIGHT, BTN_LEFT, BTN_DOWN,
+  BTN_LS,
+  BTN_COUNT
+};
+
+#define BTN_BIT(b)   (1UL << (b))
+
+// one controller poll
+struct InputFrame {
+  uint32_t tUs;              // micros() when the frame was received
+  uint32_t buttons;          // BTN_BIT() set = held
+  uint16_t joyLVert, joyRHori;
+  uint16_t trigLT, trigRT;
+};
+
+struct InputEvent {
+  uint8_t  button;
+  bool     pressed;          // false = released
+  uint32_t tUs;              // receipt time of the frame that changed it
+};
+
+typedef void (*InputHandler)(const InputEvent &e);
+
+struct InputBinding {
+  uint8_t      button;
+  InputHandler onPress;
+  InputHandler onRelease;    // may be null
+};
+
+class InputLayer {
+ public:
+  void     bind(const InputBinding *table, uint8_t count);
+  // take a new frame and run handlers for its edges; returns changed bits
+  uint32_t update(const InputFrame &f);
+
+  const InputFrame &frame()    const { return frame_; }
+  uint32_t          held()     const { return frame_.buttons; }
+  uint32_t          pressed()  const { return pressed_; }   // edges of last update
+  uint32_t          released() const { return released_; }
+
+ private:
+  InputHandler press_[BTN_COUNT]   = {};
+  InputHandler release_[BTN_COUNT] = {};
+  InputFrame   frame_    = {};
+  uint32_t     pressed_  = 0;
+  uint32_t     released_ = 0;
+  uint32_t     gen_      = 0;      // update() calls, to spot nested polls
+};
+
+// feed a recorded frame sequence through the layer, in order
+void replayInput(InputLayer &in, const InputFrame *frames, uint32_t count);
@@ -0,0 +1,71 @@
+// include/coop_scheduler.h
+
+#pragma once
+
+#include <stdint.h>
+
+//—————————————————————————————————————————————
+// Cooperative Scheduler
+//
+// Background work (input polls, display refresh, the banner timeout,
+// log output off the device) as timed tasks that run inside the
+// firmware's waits instead of between them. A wait asks for one due
+// task that fits in the time left before its deadline, judged by the
+// longest that task has ever taken, and sleeps or spins through the
+// rest, so a deadline slips only when a task outruns its own record.
+// A critical task a whole period past due runs even when it does not
+// fit: a dense run may then take one step late, but input never starves.
+//
+// Tasks run one at a time on the caller's stack and must return
+// promptly; none may wait through the scheduler itself.
+//—————————————————————————————————————————————
+
+#define SCHED_TASKS_MAX  8
+
+struct TaskSpec {
+  const char *name;
+  void      (*fn)();
+  uint32_t    periodUs;       // 0 = one-shot: runs once per start()
+  uint32_t    budgetUs;       // cost assumed until a run takes longer
+  bool        critical;       // runs late rather than not at all
+};
+
+struct TaskStats {
+  uint32_t runs;
+  uint32_t late;              // critical runs forced without fitting
+  uint32_t worstUs;           // longest run so far: the fit estimate
+  uint64_t totalUs;
+};
+
+class CoopScheduler {
+ public:
+  typedef uint32_t (*Clock)();
+  explicit CoopScheduler(Clock clock) : clock_(clock) {}
+
+  // specs stays owned by the caller; every task starts stopped
+  void     begin(const TaskSpec *specs, uint8_t n);
+  // due delayUs from now, then every period; start() again re-times it
+  void     start(uint8_t id, uint32_t delayUs = 0);
+  void     stop(uint8_t id)         { if (id < n_) active_[id] = false; }
+  bool     active(uint8_t id) const { return id < n_ && active_[id]; }
+
+  // run at most one due task that fits in leftUs (strict: never a late
+  // critical one that does not); true if one ran
+  bool     runNext(uint32_t leftUs, bool strict = false);
+  // µs until runNext(…, strict) could next have work: a task coming
+  // due, or a critical one running out of patience; UINT32_MAX if none
+  uint32_t untilNext(bool strict = false) const;
+
+  uint8_t          count() const           { return n_; }
+  const TaskSpec  &spec(uint8_t id) const  { return specs_[id]; }
+  const TaskStats &stats(uint8_t id) const { return stats_[id]; }
+  void             resetStats();
+
+ private:
+  Clock           clock_;
+  const TaskSpec *specs_ = nullptr;
+  uint8_t         n_     = 0;
+  uint32_t        dueUs_[SCHED_TASKS_MAX];
+  bool            active_[SCHED_TASKS_MAX];
+  TaskStats       stats_[SCHED_TASKS_MAX];
+};
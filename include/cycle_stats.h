@@ -0,0 +1,36 @@
+// include/cycle_stats.h
+
+#pragma once
+
+#include <stdint.h>
+
+// timing of repeated playback cycles: actual vs planned duration
+struct CycleStats {
+  uint32_t cycles;
+  uint32_t minUs, maxUs;      // actual cycle time range
+  uint64_t totalUs;
+  int64_t  driftUs;           // accumulated actual - planned
+  int32_t  worstDriftUs;      // largest single-cycle |actual - planned|
+
+  void reset() {
+    cycles = 0;
+    minUs = UINT32_MAX;
+    maxUs = 0;
+    totalUs = 0;
+    driftUs = 0;
+    worstDriftUs = 0;
+  }
+
+  void add(uint32_t actualUs, uint32_t plannedUs) {
+    int32_t d = (int32_t)(actualUs - plannedUs);
+    cycles++;
+    if (actualUs < minUs) minUs = actualUs;
+    if (actualUs > maxUs) maxUs = actualUs;
+    totalUs += actualUs;
+    driftUs += d;
+    if (d < 0) d = -d;
+    if (d > worstDriftUs) worstDriftUs = d;
+  }
+
+  uint32_t meanUs() const { return cycles ? (uint32_t)(totalUs / cycles) : 0; }
+};
@@ -0,0 +1,69 @@
+// include/deferred_log.h
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+//—————————————————————————————————————————————
+// Deferred Logger
+//
+// Motion code must never wait on the UART. log() stores the format
+// pointer and its arguments as one fixed-size record in a single-producer,
+// single-consumer ring and returns; a full ring counts the record as
+// dropped instead. drain(), run by a low-priority task (or from loop()
+// where there is none), formats the records and writes them out.
+//
+// Every argument is stored as a long, so formats use long conversions
+// only (%ld %lu %lx), plus %s for strings that outlive the record, such
+// as literals. Records come from one context at a time (the loop task,
+// never an ISR).
+//—————————————————————————————————————————————
+
+#define LOG_MAX_ARGS   12
+#define LOG_RECORDS    64      // power of two
+#define LOG_LINE_MAX   160
+
+struct LogRecord {
+  const char *fmt;
+  uint8_t     argc;
+  long        args[LOG_MAX_ARGS];
+};
+
+typedef void (*LogWriter)(const char *line, size_t len);
+
+class DeferredLog {
+ public:
+  template <class... A>
+  bool log(const char *fmt, A... a) {
+    static_assert(sizeof...(A) <= LOG_MAX_ARGS, "too many log arguments");
+    const long v[sizeof...(A) + 1] = { arg(a)..., 0 };
+    return push(fmt, v, sizeof...(A));
+  }
+
+  // format and write out up to max records; returns how many
+  uint32_t drain(LogWriter write, uint32_t max = LOG_RECORDS);
+
+  uint32_t logged()    const { return logged_.load(std::memory_order_relaxed); }
+  uint32_t dropped()   const { return dropped_.load(std::memory_order_relaxed); }
+  uint32_t highWater() const { return highWater_; }   // most records queued at once
+  uint32_t room() const {                                // records free right now
+    return LOG_RECORDS - (head_.load(std::memory_order_relaxed) -
+                          tail_.load(std::memory_order_acquire));
+  }
+
+ private:
+  template <class T> static long arg(T v) { return (long)v; }
+  static long arg(const char *s) { return (long)(intptr_t)s; }
+
+  bool push(const char *fmt, const long *args, uint8_t argc);
+
+  LogRecord             ring_[LOG_RECORDS];
+  std::atomic<uint32_t> head_{ 0 };      // producer: next slot to fill
+  std::atomic<uint32_t> tail_{ 0 };      // consumer: next slot to format
+  std::atomic<uint32_t> logged_{ 0 };
+  std::atomic<uint32_t> dropped_{ 0 };
+  uint32_t              highWater_ = 0;
+  uint32_t              reported_  = 0;  // drops already announced
+};
@@ -0,0 +1,72 @@
+// include/diff_drive.h
+
+#pragma once
+
+#include <stdint.h>
+
+#include "fixed_point.h"
+#include "segment.h"
+
+//—————————————————————————————————————————————
+// Differential-Drive Kinematics
+//
+// Motor 1 is the left wheel, motor 2 the right. Body velocity is a Twist:
+// v in mm/s (forward positive) and w in mrad/s (counter-clockwise
+// positive). Wheel speeds are signed step rates. All math is integer with
+// Q16 geometry factors computed at compile time.
+//—————————————————————————————————————————————
+
+struct Twist {
+  int32_t v;                            // mm/s
+  int32_t w;                            // mrad/s
+};
+
+struct WheelRates {
+  int32_t left;                         // steps/s, motor 1
+  int32_t right;                        // steps/s, motor 2
+};
+
+class DiffDrive {
+ public:
+  constexpr DiffDrive(uint32_t stepsPerRev, uint32_t wheelDiaMm, uint32_t trackMm)
+    : stepsPerMm_(Q16::ratio((int64_t)stepsPerRev << 16,
+                             (int64_t)FP_PI_Q16 * wheelDiaMm)),
+      mmPerStep_(Q16::fromRaw((int32_t)((int64_t)FP_PI_Q16 * wheelDiaMm / stepsPerRev))),
+      halfTrackMm_((int32_t)trackMm / 2),
+      trackMm_((int32_t)trackMm) {}
+
+  // body twist → wheel step rates; w = 0 drives straight, v = 0 spins
+  // in place, anything else follows an arc
+  inline WheelRates toWheels(Twist t) const {
+    // wheel speeds in µm/s keep the turn term exact before scaling
+    int64_t base = (int64_t)t.v * 1000, turn = (int64_t)t.w * halfTrackMm_;
+    return { umToSteps(base - turn), umToSteps(base + turn) };
+  }
+
+  // wheel step rates → body twist
+  inline Twist toTwist(WheelRates r) const {
+    int32_t l = stepsToMm(r.left), rt = stepsToMm(r.right);
+    return { (l + rt) / 2, (int32_t)((int64_t)(rt - l) * 1000 / trackMm_) };
+  }
+
+  inline int32_t mmToSteps(int32_t mm)    const { return (int32_t)stepsPerMm_.scale(mm); }
+  inline int32_t umToSteps(int64_t um)    const {
+    int64_t milli = stepsPerMm_.scale(um);
+    return (int32_t)((milli + (milli < 0 ? -500 : 500)) / 1000);
+  }
+  inline int32_t stepsToMm(int32_t steps) const { return (int32_t)mmPerStep_.scale(steps); }
+  inline int64_t stepsToUm(int64_t steps) const { return mmPerStep_.scale(steps * 1000); }
+
+  int32_t trackMm() const { return trackMm_; }
+
+  // recordings in (v, w) space: mean twist of a segment, and the segment
+  // that drives a twist for durationMs
+  Twist   segmentTwist(const Segment &s) const;
+  Segment twistSegment(Twist t, unsigned long durationMs) const;
+
+ private:
+  Q16     stepsPerMm_;
+  Q16     mmPerStep_;
+  int32_t halfTrackMm_;
+  int32_t trackMm_;
+};
@@ -0,0 +1,49 @@
+// include/feed_override.h
+
+#pragma once
+
+#include <stdint.h>
+
+#include "fixed_point.h"
+
+//—————————————————————————————————————————————
+// Feed-Rate Override
+//
+// Scales playback tick intervals by a live Q16 factor. The applied factor
+// chases the target no faster than the acceleration limit allows, so the
+// tick sequence — and with it pulse counts and axis sync — is untouched;
+// only the spacing changes.
+//—————————————————————————————————————————————
+
+#define FEED_ONE          Q16::fromInt(1)
+#define FEED_MIN          Q16::ratio(1, 10)     // 10 %
+#define FEED_MAX          Q16::fromInt(3)       // 300 %
+
+class FeedOverride {
+ public:
+  // accelStepsS2: max change of step rate; minIntervalUs: fastest tick
+  FeedOverride(uint32_t accelStepsS2, uint32_t minIntervalUs)
+    : accel_(accelStepsS2), minIntervalUs_(minIntervalUs) {}
+
+  void reset()             { target_ = current_ = FEED_ONE; }
+  void setLimits(uint32_t accelStepsS2, uint32_t minIntervalUs) {
+    accel_         = accelStepsS2;
+    minIntervalUs_ = minIntervalUs;
+  }
+  void setTarget(Q16 f);
+  Q16  target()  const     { return target_; }
+  Q16  current() const     { return current_; }
+
+  // map trigger travel (0..maxTrig): RT speeds up to 300 %, LT slows to 10 %
+  static Q16 fromTriggers(uint16_t lt, uint16_t rt, uint16_t maxTrig);
+
+  // scaled interval for one tick; moving=false lets the factor settle
+  // immediately since no axis is stepping
+  uint32_t apply(uint32_t nominalUs, bool moving);
+
+ private:
+  uint32_t accel_;
+  uint32_t minIntervalUs_;
+  Q16      target_  = FEED_ONE;
+  Q16      current_ = FEED_ONE;
+};
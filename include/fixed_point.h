@@ -0,0 +1,110 @@
+// include/fixed_point.h
+
+#pragma once
+
+#include <stdint.h>
+
+//—————————————————————————————————————————————
+// Fixed-Point Math
+//
+// Q-format arithmetic for the motion path. Nothing here touches the FPU,
+// so it is safe in ISRs (the ESP32 does not save FPU context for them).
+// Fixed<F>, the square root and the period helpers are constexpr, so
+// geometry and profile constants fold at compile time; the table trig
+// (sinQ15, cosQ15, atan2Bam) lives in fixed_point.cpp. Fixed<F> holds
+// raw / 2^F in an int32_t; products and quotients go through int64_t and
+// round to nearest.
+//—————————————————————————————————————————————
+
+template <uint8_t F>
+struct Fixed {
+  int32_t raw;
+
+  static constexpr int32_t ONE  = (int32_t)1 << F;
+  static constexpr int32_t HALF = ONE >> 1;
+
+  static constexpr Fixed fromRaw(int32_t r) { return Fixed{ r }; }
+  static constexpr Fixed fromInt(int32_t v) { return Fixed{ (int32_t)((int64_t)v << F) }; }
+  // num/den, rounded
+  static constexpr Fixed ratio(int64_t num, int64_t den) {
+    return Fixed{ (int32_t)((num * ONE + den / 2) / den) };
+  }
+
+  constexpr int32_t floor() const { return raw >> F; }
+  constexpr int32_t round() const { return (int32_t)(((int64_t)raw + HALF) >> F); }
+
+  // v × this, rounded to an integer; v may be a wide count
+  constexpr int64_t scale(int64_t v) const { return (v * raw + HALF) >> F; }
+
+  constexpr Fixed operator+(Fixed o) const { return Fixed{ raw + o.raw }; }
+  constexpr Fixed operator-(Fixed o) const { return Fixed{ raw - o.raw }; }
+  constexpr Fixed operator-()        const { return Fixed{ -raw }; }
+  constexpr Fixed operator*(Fixed o) const {
+    return Fixed{ (int32_t)(((int64_t)raw * o.raw + HALF) >> F) };
+  }
+  constexpr Fixed operator/(Fixed o) const {
+    return Fixed{ (int32_t)((((int64_t)raw << F) + o.raw / 2) / o.raw) };
+  }
+
+  constexpr bool operator==(Fixed o) const { return raw == o.raw; }
+  constexpr bool operator!=(Fixed o) const { return raw != o.raw; }
+  constexpr bool operator< (Fixed o) const { return raw <  o.raw; }
+  constexpr bool operator> (Fixed o) const { return raw >  o.raw; }
+  constexpr bool operator<=(Fixed o) const { return raw <= o.raw; }
+  constexpr bool operator>=(Fixed o) const { return raw >= o.raw; }
+};
+
+typedef Fixed<16> Q16;                  // rates, factors, geometry
+typedef Fixed<15> Q15;                  // unit-range values (sin/cos)
+
+#define FP_PI_Q16   205887L             // π in Q16
+
+//—————————————————————————————————————————————
+// Roots & Reciprocals
+//—————————————————————————————————————————————
+
+// floor(sqrt(v)), bit-by-bit: no multiply, no divide
+constexpr uint32_t isqrt64(uint64_t v) {
+  uint64_t r = 0, bit = 1ULL << 62;
+  while (bit > v) bit >>= 2;
+  while (bit) {
+    if (v >= r + bit) {
+      v -= r + bit;
+      r  = (r >> 1) + bit;
+    } else {
+      r >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)r;
+}
+
+// sqrt of an integer with a Q16 result (x < 2^30)
+constexpr Q16 sqrtQ16(uint32_t x) {
+  return Q16::fromRaw((int32_t)isqrt64((uint64_t)x << 32));
+}
+
+// µs between steps at a Q16 steps/s rate
+constexpr uint32_t periodUsQ16(Q16 rate) {
+  return rate.raw > 0
+    ? (uint32_t)(((1000000ULL << 16) + (uint32_t)rate.raw / 2) / (uint32_t)rate.raw)
+    : UINT32_MAX;
+}
+
+//—————————————————————————————————————————————
+// Angles
+//
+// Binary angles (BAM): 2^32 = one turn, so wrap-around is free.
+//—————————————————————————————————————————————
+
+#define BAM_HALF_TURN   0x80000000UL
+#define BAM_QUARTER     0x40000000UL
+
+int32_t  sinQ15(uint32_t bam);          // table + linear interpolation
+int32_t  cosQ15(uint32_t bam);
+uint32_t atan2Bam(int64_t y, int64_t x);  // CORDIC
+
+constexpr int32_t bamToMrad(uint32_t bam) {
+  // signed turn fraction × 2π·1000
+  return (int32_t)(((int64_t)(int32_t)bam * 6283) >> 32);
+}
@@ -0,0 +1,101 @@
+// include/gcode.h
+
+#pragma once
+
+#include <stdint.h>
+
+#include "diff_drive.h"
+#include "move_planner.h"
+
+//—————————————————————————————————————————————
+// G-code
+//
+// The CAM subset the rig runs: G0 rapid and G1 feed moves (X/Y = axis 1/2
+// travel in mm, F in mm/min), G4 dwell (P ms or S s), G90/G91 absolute or
+// relative, G21 mm, M17/M18 hold or release the drivers (X or Y picks
+// one, neither means both) and M2/M30 end of program. Words are
+// case-insensitive; ( ) and ; comments, N line numbers and % are skipped.
+//
+// GcodeParser takes one character at a time and keeps only the word it
+// is reading and the fields of the current line: no line buffer, no
+// allocation, so a program of any length and any line length streams
+// through a fixed few dozen bytes. GcodeInterpreter applies the modal
+// state to each line and emits at most one PlannerMove, in steps.
+//—————————————————————————————————————————————
+
+enum GcodeError : uint8_t {
+  GC_OK          = 0,
+  GC_SYNTAX      = 1,   // stray character, letter without a number, repeated word
+  GC_UNSUPPORTED = 2,   // word or code outside the subset
+  GC_RANGE       = 3,   // number too large, or a move or dwell out of reach
+  GC_NO_FEED     = 4,   // G1 before any F
+  GC_NO_MOTION   = 5,   // X/Y with no G0/G1 in effect
+};
+
+enum GcodeWord : uint8_t {
+  GW_X = 0x01, GW_Y = 0x02, GW_F = 0x04, GW_P = 0x08, GW_S = 0x10,
+};
+
+// one parsed line; values in thousandths (µm for mm, µs for P ms)
+struct GcodeLine {
+  uint8_t    words;       // GcodeWord bits present
+  uint8_t    bare;        // X/Y given without a number, as in M18 X
+  int8_t     motion;      // 0, 1, 4; -1 = none on this line
+  int8_t     distance;    // 90, 91; -1 = none
+  int8_t     mcode;       // 2, 17, 18, 30; -1 = none
+  int64_t    x, y, f, p, s;
+  uint32_t   number;      // 1-based line count since reset()
+  GcodeError error;
+};
+
+class GcodeParser {
+ public:
+  void     reset();
+  // true when c ends a line: line() then holds it until the next feed()
+  bool     feed(char c);
+  const GcodeLine &line() const { return line_; }
+
+ private:
+  enum State : uint8_t { WORD, NUMBER, PAREN, SKIP };
+
+  void     startLine();
+  bool     endLine();
+  void     fail(GcodeError e);          // keeps the first error, skips the rest
+  void     endWord();                   // apply letter_ and the number read
+  void     apply(char letter, int64_t v);
+
+  GcodeLine line_;
+  int64_t   num_     = 0;               // digits so far, point ignored
+  uint32_t  lines_   = 0;
+  char      letter_  = 0;
+  uint8_t   frac_    = 0;               // digits after the point kept
+  State     state_   = WORD;
+  bool      neg_     = false;
+  bool      sign_    = false;
+  bool      digits_  = false;
+  bool      point_   = false;
+  bool      fresh_   = true;            // next feed() starts a line
+};
+
+class GcodeInterpreter {
+ public:
+  GcodeInterpreter(const DiffDrive &drive, uint32_t maxRate)
+    : drive_(drive), maxRate_(maxRate) {}
+
+  // a new program from the given axis positions: G90, no feed, no
+  // motion mode, drivers released
+  void       begin(int64_t pos1, int64_t pos2);
+  void       setMaxRate(uint32_t maxRate) { maxRate_ = maxRate; }   // G0, and the G1 cap
+  // m.kind is PLAN_NONE for lines that only change modal state
+  GcodeError apply(const GcodeLine &l, PlannerMove &m);
+
+ private:
+  const DiffDrive &drive_;
+  uint32_t         maxRate_;
+  int64_t          posUm_[2] = { 0, 0 };   // programmed position
+  int64_t          steps_[2] = { 0, 0 };   // the same in steps
+  int64_t          feed_     = 0;          // µm/min, 0 = unset
+  int8_t           motion_   = -1;
+  bool             relative_ = false;
+  uint8_t          hold_     = 0;
+};
@@ -0,0 +1,83 @@
+// include/input_trace.h
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "controller_input.h"
+
+//—————————————————————————————————————————————
+// Controller Input Trace
+//
+// Captures the controller as a timestamped signal: a sample is stored
+// only when the buttons, sticks, triggers or link state differ from the
+// last one, into a ring that keeps the most recent INPUT_TRACE_SAMPLES.
+// Replay maps the samples onto a new start time and hands each poll the
+// state that was current at the same offset, so a build whose polls land
+// at the same times (the native simulator from boot) sees exactly the
+// captured frames. Samples travel over Serial as one text line each.
+//—————————————————————————————————————————————
+
+#define INPUT_TRACE_SAMPLES  1024
+// an export adds the tail to a full ring; load() takes it back whole
+#define INPUT_TRACE_SLOTS    (INPUT_TRACE_SAMPLES + 1)
+
+// buttons word: BTN_BIT()s plus the link flag
+#define INPUT_LINK_BIT       0x8000
+
+struct InputSample {
+  uint32_t tUs;              // micros() of the poll that saw the change
+  uint16_t buttons;
+  uint16_t joyLVert, joyRHori;
+  uint16_t trigLT, trigRT;
+};
+
+class InputTrace {
+ public:
+  // start capturing into an empty ring; times are kept relative to nowUs
+  void begin(uint32_t nowUs);
+  void capture(const InputFrame &f, bool connected);
+
+  // feed the held samples back from nowUs; capture pauses meanwhile
+  bool startReplay(uint32_t nowUs);
+  void stopReplay() { replaying_ = false; }
+  bool replaying() const { return replaying_; }
+  // overwrite the polled frame and link flag with the replayed state;
+  // replay ends after the last sample has been handed out
+  void replay(InputFrame &f, bool &connected);
+
+  uint32_t           count()    const { return count_; }
+  bool               wrapped()  const { return dropped_ != 0; }
+  uint32_t           dropped()  const { return dropped_; }
+  // oldest first, times relative to the capture start
+  InputSample        at(uint32_t i) const;
+  // the current state stamped nowUs: closes an export so a replay holds
+  // the last state for as long as the capture ran
+  InputSample        tail(uint32_t nowUs) const;
+  // replace the ring (e.g. with a trace loaded on a host), up to
+  // INPUT_TRACE_SLOTS samples: an export of a wrapped ring fits
+  void               load(const InputSample *s, uint32_t n);
+
+ private:
+  InputSample ring_[INPUT_TRACE_SLOTS];
+  uint32_t    head_      = 0;      // next slot to write
+  uint32_t    count_     = 0;
+  uint32_t    dropped_   = 0;      // overwritten by the ring wrapping
+  uint32_t    originUs_  = 0;
+  InputSample last_      = {};
+  bool        started_   = false;
+  bool        replaying_ = false;
+  uint32_t    replayUs_  = 0;      // replay start
+  uint32_t    cursor_    = 0;      // next sample to hand out
+  InputSample state_     = {};
+};
+
+// one sample per line: "I <tUs> <buttons hex> <joyLVert> <joyRHori> <trigLT> <trigRT>"
+int  formatInputSample(char *buf, size_t len, const InputSample &s);
+bool parseInputSample(const char *line, InputSample &s);
+
+// the export text line by line: a TRACE header, the I lines closed by
+// tail(nowUs) (so up to INPUT_TRACE_SLOTS of them), and "TRACE END crc="
+// over all the I lines' text
+typedef void (*TraceLineSink)(const char *line, void *ctx);
+void writeInputTrace(const InputTrace &t, uint32_t nowUs, TraceLineSink sink, void *ctx);
@@ -0,0 +1,106 @@
+// include/latency_trace.h
+
+#pragma once
+
+#include <stdint.h>
+
+//—————————————————————————————————————————————
+// Input-to-Step Latency Trace
+//
+// One trace at a time: input() stamps the controller frame that asked for
+// motion, enqueue() the moment the motion command is handed to the step
+// loop, step() the first STEP edge after it. Completed traces land in
+// log2-bucketed histograms per stage. The poll-gap histogram covers the
+// part input() cannot see: how long an event may wait before a poll
+// picks it up.
+//—————————————————————————————————————————————
+
+// bucket k holds values < 2^k µs; the last one is open-ended
+#define LATENCY_BUCKETS  20
+
+enum LatencyStage : uint8_t {
+  LAT_INPUT_TO_ENQUEUE,
+  LAT_ENQUEUE_TO_STEP,
+  LAT_INPUT_TO_STEP,
+  LAT_POLL_GAP,
+  LAT_STAGES
+};
+
+struct LatencyHist {
+  uint32_t count;
+  uint32_t minUs, maxUs;
+  uint64_t totalUs;
+  uint32_t bins[LATENCY_BUCKETS];
+
+  void reset() {
+    count = 0;
+    minUs = UINT32_MAX;
+    maxUs = 0;
+    totalUs = 0;
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) bins[i] = 0;
+  }
+
+  void add(uint32_t us) {
+    uint8_t k = us ? 32 - __builtin_clz(us) : 0;
+    if (k >= LATENCY_BUCKETS) k = LATENCY_BUCKETS - 1;
+    bins[k]++;
+    count++;
+    totalUs += us;
+    if (us < minUs) minUs = us;
+    if (us > maxUs) maxUs = us;
+  }
+
+  uint32_t meanUs() const { return count ? (uint32_t)(totalUs / count) : 0; }
+};
+
+class LatencyTrace {
+ public:
+  LatencyTrace() { reset(); }
+
+  void reset() {
+    for (uint8_t i = 0; i < LAT_STAGES; i++) hist_[i].reset();
+    state_  = IDLE;
+    inUs_   = enqUs_ = 0;
+    pollUs_ = 0;
+  }
+
+  // a frame that should start motion; restarts any open trace
+  void input(uint32_t tUs) {
+    inUs_  = tUs;
+    state_ = ARMED;
+  }
+
+  // motion handed to the step loop; ignored unless an input is open
+  void enqueue(uint32_t tUs) {
+    if (state_ != ARMED) return;
+    enqUs_ = tUs;
+    state_ = QUEUED;
+  }
+
+  // STEP edge; only the first one after enqueue() closes the trace
+  inline void step(uint32_t tUs) {
+    if (state_ != QUEUED) return;
+    state_ = IDLE;
+    hist_[LAT_INPUT_TO_ENQUEUE].add(enqUs_ - inUs_);
+    hist_[LAT_ENQUEUE_TO_STEP].add(tUs - enqUs_);
+    hist_[LAT_INPUT_TO_STEP].add(tUs - inUs_);
+  }
+
+  void cancel() { state_ = IDLE; }
+
+  // controller poll; records the gap since the previous one
+  void poll(uint32_t tUs) {
+    if (pollUs_) hist_[LAT_POLL_GAP].add(tUs - pollUs_);
+    pollUs_ = tUs;
+  }
+
+  const LatencyHist &hist(LatencyStage s) const { return hist_[s]; }
+
+ private:
+  enum State : uint8_t { IDLE, ARMED, QUEUED };
+
+  LatencyHist hist_[LAT_STAGES];
+  State       state_;
+  uint32_t    inUs_, enqUs_;
+  uint32_t    pollUs_;
+};
@@ -0,0 +1,49 @@
+// include/link_guard.h
+
+#pragma once
+
+#include <stdint.h>
+
+//—————————————————————————————————————————————
+// Controller Link Supervision
+//
+// Turns the raw connected flag into link events. A drop is reported on
+// the first poll that sees it; a (re)connection only once it has held for
+// settleMs, so the first frames after pairing are not acted on. Plain
+// logic fed with the flag and a clock, so a mocked controller can drive it.
+//—————————————————————————————————————————————
+
+enum LinkEvent : uint8_t {
+  LINK_NONE,
+  LINK_LOST,
+  LINK_UP,
+};
+
+class LinkGuard {
+ public:
+  explicit LinkGuard(uint32_t settleMs) : settleMs_(settleMs) {}
+
+  LinkEvent update(bool connected, uint32_t nowMs) {
+    if (!connected) {
+      raw_ = false;
+      if (!up_) return LINK_NONE;
+      up_ = false;
+      return LINK_LOST;
+    }
+    if (!raw_) {
+      raw_     = true;
+      sinceMs_ = nowMs;
+    }
+    if (up_ || nowMs - sinceMs_ < settleMs_) return LINK_NONE;
+    up_ = true;
+    return LINK_UP;
+  }
+
+  bool up() const { return up_; }
+
+ private:
+  uint32_t settleMs_;
+  uint32_t sinceMs_ = 0;
+  bool     raw_     = false;   // connected on the last poll
+  bool     up_      = false;   // connected and settled
+};
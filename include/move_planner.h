@@ -0,0 +1,126 @@
+// include/move_planner.h
+
+#pragma once
+
+#include <stdint.h>
+
+#include "fixed_point.h"
+#include "step_schedule.h"
+#include "stream_queue.h"
+
+//—————————————————————————————————————————————
+// Planned Moves
+//
+// A straight two-axis move with a trapezoidal speed profile: the major
+// axis ramps up at accel, cruises at maxRate and ramps down to stop on
+// the last step; the minor axis is interleaved Bresenham-style. Yields
+// the same StepTick stream as a compiled schedule, so one output loop
+// drives both.
+//—————————————————————————————————————————————
+
+// ramp positions below this, and every RAMP_RESEED_TICKS-th, take the
+// exact square root; the rest step from their neighbour by recurrence
+#define RAMP_EXACT_TICKS   32
+#define RAMP_RESEED_TICKS  64
+
+// tick spacing along an acceleration ramp, 1e6 / sqrt(accel·(2n+1)) µs
+// at ramp position n. Walking n up or down one tick at a time costs one
+// 32-bit division, c(n) = c(n−1)·(4n−1)/(4n+1), instead of a square root
+// and a 64-bit division; the exact value is reseeded often enough that
+// rounding never drifts past a fraction of a µs.
+class RampPeriod {
+ public:
+  void     begin(uint32_t accel) { accel_ = accel ? accel : 1; n_ = UINT32_MAX; }
+  uint32_t at(uint32_t n);
+
+ private:
+  uint32_t accel_ = 1;
+  uint32_t n_     = UINT32_MAX;            // position of q8_, none yet
+  uint32_t q8_    = 0;                     // period there, µs × 256
+};
+
+class LinearMove {
+ public:
+  // d1/d2: signed steps per axis; returns false if the move is too long
+  bool     begin(int64_t d1, int64_t d2, uint32_t maxRate, uint32_t accel);
+  bool     next(StepTick &t);
+
+  uint32_t ticks() const { return ticks_; }
+
+ private:
+  uint32_t intervalAt(uint32_t k);
+
+  uint32_t ticks_     = 0;
+  uint32_t minor_     = 0;                 // minor axis steps
+  uint32_t tick_      = 0;
+  uint32_t acc_       = 0;
+  uint32_t rampTicks_ = 0;                 // ticks to reach cruise
+  uint32_t cruiseUs_  = 0;
+  RampPeriod ramp_;
+  uint8_t  major_     = 0;
+  uint8_t  dirBits_   = 0;
+  uint8_t  enableBits_= 0;
+};
+
+// brings a running tick stream to rest: further ticks are stretched along
+// the deceleration curve a LinearMove ends on, starting from the current
+// tick spacing, so no steps are skipped and position stays exact
+class StopRamp {
+ public:
+  void     begin(uint32_t intervalUs, uint32_t accel);
+  // interval after the current tick; false once the axes are at rest
+  bool     next(uint32_t &intervalUs);
+
+  uint32_t ticksLeft() const { return n_; }
+
+ private:
+  uint32_t   n_ = 0;                       // ramp position, 0 = slowest
+  RampPeriod ramp_;
+};
+
+// one queued planner action, as a G-code program produces them
+enum PlanKind : uint8_t {
+  PLAN_NONE  = 0,          // modal change only, nothing to run
+  PLAN_MOVE  = 1,          // straight move of d1/d2 steps at value steps/s
+  PLAN_DWELL = 2,          // hold still for value µs
+  PLAN_HOLD  = 3,          // axes: drivers kept enabled between moves
+};
+
+struct PlannerMove {
+  uint8_t  kind;
+  uint8_t  axes;
+  int32_t  d1, d2;
+  uint32_t value;
+};
+
+#define MOVE_QUEUE_LEN  16
+
+typedef StreamQueue<PlannerMove, MOVE_QUEUE_LEN> MoveQueue;
+
+// tick source over a MoveQueue: each move ramps up and back down to rest
+// (no blending between moves); held axes stay enabled through the moves
+// of the other axis. An empty queue that has not ended dwells starveUs
+// at a time until more arrives.
+class MoveStream {
+ public:
+  void     begin(MoveQueue &q, uint32_t accel, uint32_t starveUs);
+  bool     next(StepTick &t);
+
+  uint32_t completed() const { return completed_; }   // actions fully output
+  uint32_t underruns() const { return underruns_; }   // ran dry after starting
+
+ private:
+  void     still(StepTick &t, uint32_t us);
+
+  MoveQueue  *queue_     = nullptr;
+  LinearMove  move_;
+  uint32_t    accel_     = 1;
+  uint32_t    starveUs_  = 0;
+  uint16_t    seq_       = 0;      // actions started, for StepTick.block
+  uint8_t     holdBits_  = 0;
+  uint8_t     dirBits_   = 0;
+  bool        inMove_    = false;
+  bool        starving_  = false;
+  uint32_t    completed_ = 0;
+  uint32_t    underruns_ = 0;
+};
@@ -0,0 +1,51 @@
+// include/odometry.h
+
+#pragma once
+
+#include <stdint.h>
+
+#include "fixed_point.h"
+
+//—————————————————————————————————————————————
+// Dead-Reckoning Odometry
+//
+// Integrates signed wheel step positions (motor 1 = left) into a pose.
+// Heading is a 32-bit binary angle (2^32 = one turn, wraps for free),
+// x/y are accumulated in Q16 µm, and trig comes from a 256-entry sine
+// table with linear interpolation — an update is a handful of multiplies.
+//—————————————————————————————————————————————
+
+struct Pose {
+  int32_t  xMm, yMm;
+  int32_t  thetaMrad;                   // -π..π
+};
+
+class Odometry {
+ public:
+  constexpr Odometry(uint32_t stepsPerRev, uint32_t wheelDiaMm, uint32_t trackMm)
+    : umPerStepQ16_((int64_t)FP_PI_Q16 * wheelDiaMm * 1000 / stepsPerRev),
+      bamPerStepQ8_((int64_t)(((uint64_t)wheelDiaMm << 39) /
+                              ((uint64_t)stepsPerRev * trackMm))) {}
+
+  // restart at pose 0 with these wheel positions as the baseline
+  void reset(int64_t pos1, int64_t pos2);
+  // fold in wheel motion since the previous call
+  void update(int64_t pos1, int64_t pos2);
+
+  Pose     pose()    const;
+  int64_t  xUm()     const { return xQ16_ >> 16; }
+  int64_t  yUm()     const { return yQ16_ >> 16; }
+  uint32_t heading() const { return (uint32_t)(thetaQ8_ >> 8); }
+
+  // wheel steps for a straight run of um, and per-wheel steps (right
+  // forward, left back) for an in-place turn of bam
+  int64_t  driveSteps(int64_t um)  const { return (um << 16) / umPerStepQ16_; }
+  int64_t  spinSteps(int32_t bam)  const { return ((int64_t)bam << 8) / (2 * bamPerStepQ8_); }
+
+ private:
+  int64_t umPerStepQ16_;
+  int64_t bamPerStepQ8_;
+  int64_t last1_ = 0, last2_ = 0;
+  int64_t xQ16_  = 0, yQ16_  = 0;      // µm, Q16
+  int64_t thetaQ8_ = 0;                 // BAM, Q8
+};
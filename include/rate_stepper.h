@@ -0,0 +1,42 @@
+// include/rate_stepper.h
+
+#pragma once
+
+#include <stdint.h>
+
+#include "step_schedule.h"
+
+// Turns signed per-axis step rates into due steps (phase accumulator per
+// axis). Poll due() with the current time; at most one step of backlog is
+// kept, so a late poll never produces a burst.
+class RateStepper {
+ public:
+  void setRates(int32_t rate1, int32_t rate2) {
+    rate_[0] = rate1 < 0 ? -rate1 : rate1;
+    rate_[1] = rate2 < 0 ? -rate2 : rate2;
+    if (!rate_[0]) phase_[0] = 0;
+    if (!rate_[1]) phase_[1] = 0;
+  }
+
+  // mask of axes owing a step; call again to drain a remaining backlog
+  uint8_t due(uint32_t nowUs) {
+    uint32_t dt = nowUs - lastUs_;
+    lastUs_ = nowUs;
+    if (dt > 1000000UL) dt = 1000000UL;
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < 2; i++) {
+      phase_[i] += (uint64_t)rate_[i] * dt;
+      if (phase_[i] >= 2000000ULL) phase_[i] = 2000000ULL;
+      if (phase_[i] >= 1000000ULL) {
+        phase_[i] -= 1000000ULL;
+        mask |= i ? AXIS2_BIT : AXIS1_BIT;
+      }
+    }
+    return mask;
+  }
+
+ private:
+  uint32_t rate_[2]  = { 0, 0 };
+  uint64_t phase_[2] = { 0, 0 };
+  uint32_t lastUs_   = 0;
+};
@@ -0,0 +1,38 @@
+// include/robot_config.h
+
+#pragma once
+
+#include <stdint.h>
+
+//—————————————————————————————————————————————
+// Robot Configuration
+//
+// Wiring, drive geometry and the built-in motion defaults, shared by the
+// firmware and the native simulator and benchmarks so neither copies
+// them. The shell's parameters start from the motion values here.
+//—————————————————————————————————————————————
+
+// Motor 1 pins
+static const int      ENABLE1_PIN   = 5;
+static const int      DIR1_PIN      = 17;
+static const int      STEP1_PIN     = 16;
+
+// Motor 2 pins (Grove A & B)
+static const int      ENABLE2_PIN   = 21;
+static const int      DIR2_PIN      = 22;
+static const int      STEP2_PIN     = 26;
+
+// M5 front buttons (active low): C = emergency stop, A = clear it
+static const int      ESTOP_PIN       = 37;
+static const int      ESTOP_CLEAR_PIN = 39;
+
+static const int      STEP_DELAY_US = 200;
+static const uint32_t MIN_STEP_INTERVAL_US = 2 * STEP_DELAY_US;
+static const uint32_t MAX_ACCEL_STEPS_S2   = 4000;  // step-rate change limit
+static const uint32_t MAX_SAFE_RATE        = 2000;  // steps/s for planned moves
+static const uint32_t SEGMENT_GAP_US = 50000;   // settle time after each segment
+
+// RoboCan geometry: motor 1 = left wheel, motor 2 = right wheel
+static const uint32_t STEPS_PER_REV = 1600;
+static const uint32_t WHEEL_DIA_MM  = 100;
+static const uint32_t TRACK_MM      = 150;     // wheel centre to centre
@@ -0,0 +1,15 @@
+// include/segment.h
+
+#pragma once
+
+#include <stdint.h>
+
+#define              MAX_SEGMENTS  100
+
+// one recorded micro-movement: direction (±1 or 0) and pulse count per
+// motor, replayed over durationMs
+struct Segment {
+  int8_t           dir1, dir2;
+  long             pulses1, pulses2;
+  unsigned long    durationMs;
+};
@@ -0,0 +1,44 @@
+// include/segment_stream.h
+
+#pragma once
+
+#include <stdint.h>
+#include "segment.h"
+#include "step_schedule.h"
+#include "stream_queue.h"
+
+//—————————————————————————————————————————————
+// Segment Stream
+//
+// Live segments from the host, run as they arrive instead of from a
+// stored recording. The command handler pushes into a small queue and
+// SegmentStream turns its head into step ticks for runTicks(), one
+// uncompiled block at a time and with no settle gap between segments.
+//—————————————————————————————————————————————
+
+#define SEGMENT_QUEUE_LEN  16
+
+typedef StreamQueue<Segment, SEGMENT_QUEUE_LEN> SegmentQueue;
+
+// tick source over a SegmentQueue; an empty queue that has not ended
+// dwells starveUs at a time, still holding DIR/ENA, until more arrives
+class SegmentStream {
+ public:
+  void     begin(SegmentQueue &q, uint32_t starveUs);
+  bool     next(StepTick &t);
+
+  uint32_t completed() const  { return completed_; }   // segments fully output
+  uint32_t underruns() const  { return underruns_; }   // ran dry after starting
+
+ private:
+  SegmentQueue  *queue_     = nullptr;
+  ScheduleBlock  blk_       = {};
+  uint32_t       starveUs_  = 0;
+  uint32_t       tick_      = 0;   // next tick within the block
+  uint32_t       acc_       = 0;   // interleave error term
+  uint16_t       seq_       = 0;   // segments started, for StepTick.block
+  bool           inBlock_   = false;
+  bool           starving_  = false;
+  uint32_t       completed_ = 0;
+  uint32_t       underruns_ = 0;
+};
@@ -0,0 +1,41 @@
+// include/shell_line.h
+
+#pragma once
+
+#include <stdint.h>
+
+//—————————————————————————————————————————————
+// Shell Line
+//
+// Text commands typed at the serial port, assembled one byte at a time
+// as serviceHost() hands them over, so loop() and the motion loop never
+// wait for a line to finish. A completed line is split into words in
+// place; backspace edits, CR, LF or CRLF end a line, and a line longer
+// than the buffer is reported as such and discarded.
+//—————————————————————————————————————————————
+
+#define SHELL_LINE_MAX  64
+#define SHELL_ARGS_MAX  9
+
+class ShellLine {
+ public:
+  // true when c completes a non-blank line: its words stay readable
+  // until the next feed()
+  bool        feed(char c);
+  // at the start of a line: nothing typed since the last one ended
+  bool        empty() const    { return done_ || (!n_ && !over_); }
+  bool        overflow() const { return over_; }   // too long, or too many words
+  uint8_t     argc() const     { return argc_; }
+  const char *arg(uint8_t i) const { return i < argc_ ? argv_[i] : ""; }
+
+ private:
+  char        buf_[SHELL_LINE_MAX + 1];
+  const char *argv_[SHELL_ARGS_MAX];
+  uint8_t     n_    = 0;
+  uint8_t     argc_ = 0;
+  bool        over_ = false;
+  bool        done_ = false;            // the last feed() completed a line
+};
+
+// whole decimal number, no sign or junk; false if not one or > 2^32-1
+bool parseU32(const char *s, uint32_t &v);
@@ -0,0 +1,91 @@
+// include/step_schedule.h
+
+#pragma once
+
+#include <stdint.h>
+#include "segment.h"
+
+//—————————————————————————————————————————————
+// Compiled Step Schedule
+//
+// A recording is compiled once, before motion starts, into a flat table
+// the playback loop only has to walk: one block per segment carrying the
+// tick interval and DIR/ENA state, plus 2-bit per-tick axis masks for
+// segments whose motors step at different rates.
+//—————————————————————————————————————————————
+
+#define AXIS1_BIT            0x01
+#define AXIS2_BIT            0x02
+#define AXIS_ALL             (AXIS1_BIT | AXIS2_BIT)
+
+// packed per-tick masks, 4 ticks per byte
+#define SCHEDULE_MASK_BYTES  16384
+
+enum BlockKind : uint8_t {
+  BLOCK_UNIFORM     = 0,   // same axis mask on every tick
+  BLOCK_PACKED      = 1,   // per-tick masks stored in the arena
+  BLOCK_INTERLEAVED = 2,   // minor axis interleaved on the fly (arena full, or streamed)
+};
+
+struct ScheduleBlock {
+  uint32_t ticks;          // step ticks; 0 = dwell for periodUs
+  uint32_t periodUs;       // base interval between ticks
+  uint32_t remUs;          // first remUs ticks run 1 µs long
+  uint32_t aux;            // PACKED: arena byte offset, INTERLEAVED: minor pulses
+  uint8_t  kind;
+  uint8_t  mask;           // UNIFORM: stepping axes, otherwise the major axis
+  uint8_t  dirBits;        // axes with DIR driven HIGH
+  uint8_t  enableBits;     // axes with the driver enabled
+};
+
+struct StepSchedule {
+  uint32_t       stamp;      // segmentsStamp() of the source recording
+  uint16_t       blockCount;
+  uint16_t       reserved;
+  uint32_t       maskBytes;  // bytes of masks[] in use
+  ScheduleBlock  blocks[MAX_SEGMENTS];
+  uint8_t        masks[SCHEDULE_MASK_BYTES];
+};
+
+// bytes of a schedule that actually need storing
+inline uint32_t scheduleStoredSize(const StepSchedule &s) {
+  return (uint32_t)(sizeof(StepSchedule) - SCHEDULE_MASK_BYTES) + s.maskBytes;
+}
+
+// one step event handed to the output loop
+struct StepTick {
+  uint8_t  mask;           // axes to pulse now
+  uint8_t  dirBits;
+  uint8_t  enableBits;
+  uint16_t block;          // source segment index
+  uint32_t intervalUs;     // time until the next tick
+};
+
+uint32_t segmentsStamp(const Segment *segs, uint16_t count);
+// one segment as a block without arena masks: UNIFORM, or INTERLEAVED
+// when its axes step at different rates
+void     compileBlock(ScheduleBlock &b, const Segment &s);
+void     compileSchedule(StepSchedule &out, const Segment *segs, uint16_t count);
+bool     scheduleMatches(const StepSchedule &s, const Segment *segs, uint16_t count);
+
+// walks a compiled schedule tick by tick; gapUs inserts a dwell between
+// blocks. reverse retraces the path: blocks and ticks in mirror order with
+// the directions of enabled axes inverted, straight off the forward table.
+class ScheduleCursor {
+ public:
+  void begin(const StepSchedule &s, bool reverse, uint32_t gapUs);
+  bool next(StepTick &t);
+
+ private:
+  const StepSchedule  *sched_   = nullptr;
+  const ScheduleBlock *blk_     = nullptr;
+  bool                 reverse_ = false;
+  uint32_t             gapUs_   = 0;
+  uint16_t             left_    = 0;   // blocks not yet started
+  uint16_t             idx_     = 0;   // current block index
+  uint32_t             tick_    = 0;   // next tick within the block
+  uint32_t             acc_     = 0;   // interleave error term
+  uint8_t              dirBits_ = 0;   // DIR levels for the current block
+  bool                 inBlock_ = false;
+  bool                 gapDue_  = false;
+};
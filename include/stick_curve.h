@@ -0,0 +1,50 @@
+// include/stick_curve.h
+
+#pragma once
+
+#include <stdint.h>
+
+#include "fixed_point.h"
+
+//—————————————————————————————————————————————
+// Stick Response Curves
+//
+// Dead zone, expo, output scaling and inversion are folded into one
+// 256-entry table per axis, generated at compile time and indexed by the
+// top byte of the raw 0..65535 stick value. Shaping a reading is a single
+// table load; constexpr tables live in flash.
+//—————————————————————————————————————————————
+
+#define STICK_TABLE_SIZE  256
+
+struct StickShape {
+  uint8_t deadPct;          // % of half travel around centre that reads 0
+  uint8_t expoPct;          // blend of x³ into x: 0 = linear, 100 = cubic
+  bool    invert;
+};
+
+struct StickTable {
+  int16_t out[STICK_TABLE_SIZE];
+
+  constexpr int16_t operator()(uint16_t raw) const { return out[raw >> 8]; }
+};
+
+constexpr StickTable makeStickTable(StickShape s, int16_t maxOut) {
+  StickTable t{};
+  const int32_t half  = 32768;
+  const int32_t reach = half - 128;     // offset of the outermost entries
+  const int32_t dead  = half * s.deadPct / 100;
+  for (int32_t i = 0; i < STICK_TABLE_SIZE; i++) {
+    int32_t c = (i << 8) + 128 - half;  // centre of the entry's range
+    int32_t m = c < 0 ? -c : c;
+    int32_t y = 0;
+    if (m > dead) {
+      Q15 x  = Q15::ratio(m - dead, reach - dead);
+      Q15 x3 = x * x * x;
+      Q15 e  = Q15::fromRaw((x.raw * (100 - s.expoPct) + x3.raw * s.expoPct) / 100);
+      y = (int32_t)e.scale(maxOut);
+    }
+    t.out[i] = (int16_t)((c < 0) != s.invert ? -y : y);
+  }
+  return t;
+}
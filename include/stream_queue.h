@@ -0,0 +1,41 @@
+// include/stream_queue.h
+
+#pragma once
+
+#include <stdint.h>
+
+// fixed ring feeding a streamed run: the host side pushes, the run's tick
+// source pops. Both run on the loop task (pushes from the motion loop's
+// input poll), so there is no locking.
+template <class T, uint8_t N>
+class StreamQueue {
+ public:
+  void reset() { head_ = count_ = 0; ended_ = false; }
+
+  bool push(const T &v) {
+    if (count_ >= N || ended_) return false;
+    ring_[(head_ + count_) % N] = v;
+    count_++;
+    return true;
+  }
+
+  bool pop(T &v) {
+    if (!count_) return false;
+    v     = ring_[head_];
+    head_ = (head_ + 1) % N;
+    count_--;
+    return true;
+  }
+
+  uint8_t size() const  { return count_; }
+  uint8_t space() const { return N - count_; }
+  // no more items will come: the run finishes once the queue drains
+  void    end()         { ended_ = true; }
+  bool    ended() const { return ended_; }
+
+ private:
+  T       ring_[N];
+  uint8_t head_  = 0;        // oldest item
+  uint8_t count_ = 0;
+  bool    ended_ = false;
+};
@@ -0,0 +1,80 @@
+// include/telemetry.h
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//—————————————————————————————————————————————
+// Motion Telemetry
+//
+// The motion code only stores a few 32-bit words per step: when each axis
+// last stepped and the planned time between its steps. sample() takes a
+// snapshot of those at the configured rate for a sender that runs beside
+// the motion loop (its own task on the device), which adds positions
+// and mode flags and ships it as a COBS frame. The step path never
+// formats or writes anything.
+//—————————————————————————————————————————————
+
+#define TELEMETRY_FRAME_SAMPLE  0x54    // frame type byte
+#define TELEMETRY_SAMPLE_BYTES  52      // packed wire size
+
+enum TelemetryFlag : uint16_t {
+  TLM_RECORDING = 0x0001,
+  TLM_PLAYBACK  = 0x0002,   // schedule, return or planned move running
+  TLM_STOPPING  = 0x0004,   // abort requested, winding down
+  TLM_ESTOP     = 0x0008,
+  TLM_LINK      = 0x0010,   // controller connected and settled
+  TLM_REPLAY    = 0x0020,   // input from a trace, not the pad
+  TLM_STREAM    = 0x0040,   // running segments streamed by the host
+};
+
+struct TelemetrySample {
+  uint32_t seq;             // sample number; a gap = samples not sent
+  uint32_t tUs;
+  int32_t  pos[2];          // steps from origin
+  uint32_t planUs[2];       // commanded time between this axis's steps, 0 = idle
+  uint32_t stepUs[2];       // measured time between its last two STEP edges
+  uint32_t lastStepUs[2];   // micros() of its last STEP edge
+  uint32_t loopUs;          // longest gap between input polls since the last sample
+  int32_t  feed;            // feed override, Q16 raw
+  uint8_t  dirBits, enableBits;
+  uint16_t flags;           // TelemetryFlag
+};
+
+class MotionTelemetry {
+ public:
+  // writer side, motion loop only
+  void step(uint8_t mask, uint32_t nowUs);
+  // tick stream: mask steps now, intervalUs until the next tick
+  void tick(uint8_t mask, uint32_t intervalUs);
+  void rates(int32_t r1, int32_t r2);       // live drive, steps/s
+  void idle();                              // motion ended
+  void poll(uint32_t nowUs);
+
+  // sender side
+  void     setRate(uint32_t hz);
+  uint32_t rate() const { return hz_; }
+  // true when a sample is due at nowUs; fills the motion fields, the
+  // caller adds the rest
+  bool     sample(uint32_t nowUs, TelemetrySample &s);
+  void     skipped() { skipped_++; }        // frame not sent: port busy
+  uint32_t skips() const { return skipped_; }
+
+ private:
+  volatile uint32_t planUs_[2]   = { 0, 0 };
+  volatile uint32_t stepUs_[2]   = { 0, 0 };
+  volatile uint32_t lastStep_[2] = { 0, 0 };
+  volatile uint32_t loopMax_     = 0;
+  uint32_t          sinceStep_[2] = { 0, 0 };   // planned µs since the axis stepped
+  uint32_t          lastPoll_    = 0;
+  uint32_t          hz_          = 0;
+  uint32_t          periodUs_    = 0;
+  uint32_t          dueUs_       = 0;
+  uint32_t          seq_         = 0;
+  uint32_t          skipped_     = 0;
+};
+
+// little-endian, fields in declaration order
+size_t packTelemetry(const TelemetrySample &s, uint8_t *out);
+bool   unpackTelemetry(const uint8_t *in, size_t len, TelemetrySample &s);
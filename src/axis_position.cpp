@@ -0,0 +1,25 @@
+// src/axis_position.cpp
+
+#include "axis_position.h"
+
+void AxisPositions::setOrigin() {
+  set(0, 0);
+}
+
+void AxisPositions::set(int64_t p1, int64_t p2) {
+  writeBegin();
+  pos_[0] = p1;
+  pos_[1] = p2;
+  writeEnd();
+}
+
+void AxisPositions::read(int64_t &p1, int64_t &p2) const {
+  uint32_t s0, s1;
+  do {
+    s0 = seq_.load(std::memory_order_acquire);
+    p1 = pos_[0];
+    p2 = pos_[1];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    s1 = seq_.load(std::memory_order_relaxed);
+  } while ((s0 & 1) || s0 != s1);
+}
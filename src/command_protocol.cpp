@@ -0,0 +1,46 @@
+// src/command_protocol.cpp
+
+#include "command_protocol.h"
+
+void WireOut::segment(const Segment &s) {
+  u8((uint8_t)s.dir1);
+  u8((uint8_t)s.dir2);
+  u32((uint32_t)s.pulses1);
+  u32((uint32_t)s.pulses2);
+  u32((uint32_t)s.durationMs);
+}
+
+Segment WireIn::segment() {
+  Segment s = {};                     // zero padding: segmentsStamp() hashes it
+  s.dir1       = (int8_t)u8();
+  s.dir2       = (int8_t)u8();
+  s.pulses1    = (long)(int32_t)u32();
+  s.pulses2    = (long)(int32_t)u32();
+  s.durationMs = u32();
+  return s;
+}
+
+// a delimiter opens a frame and the next one closes it, so text typed
+// between frames still reaches the single-letter commands
+RxResult FrameReader::feed(uint8_t b) {
+  if (!inFrame_) {
+    if (b) return RX_TEXT;
+    inFrame_ = true;
+    n_       = 0;
+    over_    = false;
+    return RX_NONE;
+  }
+  if (b) {
+    if (n_ < RAW_MAX) raw_[n_++] = b;
+    else over_ = true;
+    return RX_NONE;
+  }
+  if (!n_) return RX_NONE;              // back-to-back delimiters
+  inFrame_ = false;
+  uint8_t type;
+  if (over_ || !frameDecode(raw_, n_, buf_, type, len_)) {
+    errors_++;
+    return RX_NONE;
+  }
+  return RX_FRAME;
+}
@@ -0,0 +1,35 @@
+// src/controller_input.cpp
+
+#include "controller_input.h"
+
+void InputLayer::bind(const InputBinding *table, uint8_t count) {
+  for (uint8_t i = 0; i < BTN_COUNT; i++) press_[i] = release_[i] = nullptr;
+  for (uint8_t i = 0; i < count; i++) {
+    if (table[i].button >= BTN_COUNT) continue;
+    press_[table[i].button]   = table[i].onPress;
+    release_[table[i].button] = table[i].onRelease;
+  }
+}
+
+uint32_t InputLayer::update(const InputFrame &f) {
+  uint32_t changed = (f.buttons ^ frame_.buttons) & (BTN_BIT(BTN_COUNT) - 1);
+  pressed_  = changed & f.buttons;
+  released_ = changed & ~f.buttons;
+  frame_    = f;
+  uint32_t gen = ++gen_;
+
+  for (uint32_t bits = changed; bits; bits &= bits - 1) {
+    uint8_t      b  = (uint8_t)__builtin_ctz(bits);
+    bool         on = f.buttons & BTN_BIT(b);
+    InputHandler h  = on ? press_[b] : release_[b];
+    if (h) h(InputEvent{ b, on, f.tUs });
+    // a blocking handler (playback, moves) polls on its own; edges left
+    // from this frame are stale by the time it returns
+    if (gen != gen_) break;
+  }
+  return changed;
+}
+
+void replayInput(InputLayer &in, const InputFrame *frames, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) in.update(frames[i]);
+}
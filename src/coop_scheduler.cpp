@@ -0,0 +1,77 @@
+// src/coop_scheduler.cpp
+
+#include "coop_scheduler.h"
+
+void CoopScheduler::begin(const TaskSpec *specs, uint8_t n) {
+  specs_ = specs;
+  n_     = n < SCHED_TASKS_MAX ? n : SCHED_TASKS_MAX;
+  for (uint8_t i = 0; i < n_; i++) active_[i] = false;
+  resetStats();
+}
+
+void CoopScheduler::start(uint8_t id, uint32_t delayUs) {
+  if (id >= n_) return;
+  dueUs_[id]  = clock_() + delayUs;
+  active_[id] = true;
+}
+
+void CoopScheduler::resetStats() {
+  for (uint8_t i = 0; i < n_; i++) stats_[i] = TaskStats{ 0, 0, specs_[i].budgetUs, 0 };
+}
+
+bool CoopScheduler::runNext(uint32_t leftUs, bool strict) {
+  uint32_t now  = clock_();
+  int8_t   pick = -1;
+  int32_t  most = -1;
+  bool     fits = false;
+  for (uint8_t i = 0; i < n_; i++) {
+    if (!active_[i]) continue;
+    int32_t late = (int32_t)(now - dueUs_[i]);
+    if (late < 0 || late <= most) continue;
+    bool fit     = stats_[i].worstUs <= leftUs;
+    bool starved = !strict && specs_[i].critical && (uint32_t)late >= specs_[i].periodUs;
+    if (!fit && !starved) continue;
+    pick = (int8_t)i;                   // the most overdue that may run
+    most = late;
+    fits = fit;
+  }
+  if (pick < 0) return false;
+
+  // re-time before running, so the task may start() or stop() itself;
+  // a periodic task that fell a whole period behind skips the backlog
+  const TaskSpec &t = specs_[pick];
+  if (t.periodUs) {
+    dueUs_[pick] += t.periodUs;
+    if ((int32_t)(now - dueUs_[pick]) >= 0) dueUs_[pick] = now + t.periodUs;
+  } else {
+    active_[pick] = false;
+  }
+  t.fn();
+
+  uint32_t   took = clock_() - now;
+  TaskStats &s    = stats_[pick];
+  s.runs++;
+  if (!fits) s.late++;
+  s.totalUs += took;
+  if (took > s.worstUs) s.worstUs = took;
+  return true;
+}
+
+uint32_t CoopScheduler::untilNext(bool strict) const {
+  uint32_t now  = clock_();
+  uint32_t next = UINT32_MAX;
+  for (uint8_t i = 0; i < n_; i++) {
+    if (!active_[i]) continue;
+    int32_t  late = (int32_t)(now - dueUs_[i]);
+    uint32_t wait;
+    if (late < 0) {
+      wait = (uint32_t)-late;
+    } else if (!strict && specs_[i].critical) {
+      wait = (uint32_t)late < specs_[i].periodUs ? specs_[i].periodUs - (uint32_t)late : 0;
+    } else {
+      continue;                         // due, but it did not fit
+    }
+    if (wait < next) next = wait;
+  }
+  return next;
+}
@@ -0,0 +1,51 @@
+// src/deferred_log.cpp
+
+#include "deferred_log.h"
+
+#include <stdio.h>
+
+// producer side: a bounded copy and two atomic stores, nothing that waits
+bool DeferredLog::push(const char *fmt, const long *args, uint8_t argc) {
+  uint32_t head = head_.load(std::memory_order_relaxed);
+  uint32_t used = head - tail_.load(std::memory_order_acquire);
+  if (used >= LOG_RECORDS) {
+    dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return false;
+  }
+  LogRecord &r = ring_[head & (LOG_RECORDS - 1)];
+  r.fmt  = fmt;
+  r.argc = argc;
+  for (uint8_t i = 0; i < LOG_MAX_ARGS; i++) r.args[i] = i < argc ? args[i] : 0;
+  head_.store(head + 1, std::memory_order_release);
+  logged_.store(logged_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (used + 1 > highWater_) highWater_ = used + 1;
+  return true;
+}
+
+uint32_t DeferredLog::drain(LogWriter write, uint32_t max) {
+  char     line[LOG_LINE_MAX];
+  uint32_t n = 0;
+
+  uint32_t drops = dropped_.load(std::memory_order_relaxed);
+  if (drops != reported_) {
+    int len = snprintf(line, sizeof(line), "!! log: %lu records dropped\n",
+                       (unsigned long)(drops - reported_));
+    write(line, (size_t)len);
+    reported_ = drops;
+  }
+
+  while (n < max) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) break;
+    const LogRecord &r = ring_[tail & (LOG_RECORDS - 1)];
+    const long      *a = r.args;
+    // surplus arguments are ignored by the format
+    int len = snprintf(line, sizeof(line), r.fmt, a[0], a[1], a[2], a[3], a[4], a[5],
+                       a[6], a[7], a[8], a[9], a[10], a[11]);
+    tail_.store(tail + 1, std::memory_order_release);
+    if (len < 0) continue;
+    write(line, (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1);
+    n++;
+  }
+  return n;
+}
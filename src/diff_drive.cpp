@@ -0,0 +1,25 @@
+// src/diff_drive.cpp
+
+#include "diff_drive.h"
+
+Twist DiffDrive::segmentTwist(const Segment &s) const {
+  if (!s.durationMs) return { 0, 0 };
+  WheelRates r = {
+    (int32_t)((int64_t)s.dir1 * s.pulses1 * 1000 / (int64_t)s.durationMs),
+    (int32_t)((int64_t)s.dir2 * s.pulses2 * 1000 / (int64_t)s.durationMs),
+  };
+  return toTwist(r);
+}
+
+Segment DiffDrive::twistSegment(Twist t, unsigned long durationMs) const {
+  WheelRates r = toWheels(t);
+  int64_t p1 = (int64_t)r.left  * (int64_t)durationMs / 1000;
+  int64_t p2 = (int64_t)r.right * (int64_t)durationMs / 1000;
+  Segment s;
+  s.dir1       = p1 > 0 ? 1 : p1 < 0 ? -1 : 0;
+  s.dir2       = p2 > 0 ? 1 : p2 < 0 ? -1 : 0;
+  s.pulses1    = (long)(p1 < 0 ? -p1 : p1);
+  s.pulses2    = (long)(p2 < 0 ? -p2 : p2);
+  s.durationMs = durationMs;
+  return s;
+}
@@ -0,0 +1,49 @@
+// src/feed_override.cpp
+
+#include "feed_override.h"
+
+void FeedOverride::setTarget(Q16 f) {
+  if (f < FEED_MIN) f = FEED_MIN;
+  if (f > FEED_MAX) f = FEED_MAX;
+  target_ = f;
+}
+
+Q16 FeedOverride::fromTriggers(uint16_t lt, uint16_t rt, uint16_t maxTrig) {
+  if (!maxTrig) return FEED_ONE;
+  Q16 f = FEED_ONE + (FEED_MAX - FEED_ONE) * Q16::ratio(rt, maxTrig)
+                   - (FEED_ONE - FEED_MIN) * Q16::ratio(lt, maxTrig);
+  return f < FEED_MIN ? FEED_MIN : f;
+}
+
+uint32_t FeedOverride::apply(uint32_t nominalUs, bool moving) {
+  if (!moving || !nominalUs) {
+    current_ = target_;
+    return (uint32_t)((((uint64_t)nominalUs << 16) + current_.raw / 2) / current_.raw);
+  }
+
+  // never hold a factor beyond what the minimum interval can deliver,
+  // otherwise slowing down would first have to unwind the excess
+  Q16 reach = nominalUs / minIntervalUs_ >= 3 ? FEED_MAX
+            : Q16::ratio(nominalUs, minIntervalUs_);
+  if (current_ > reach) current_ = reach > FEED_MIN ? reach : FEED_MIN;
+
+  uint32_t intervalUs = (uint32_t)((((uint64_t)nominalUs << 16) + current_.raw / 2) /
+                                   current_.raw);
+  if (intervalUs < minIntervalUs_) intervalUs = minIntervalUs_;
+
+  // step rate is 1e6/nominalUs × factor, so over this tick the factor may
+  // move by accel × dt / rate = accel × dt × nominalUs / 1e12
+  if (current_ != target_) {
+    uint64_t us2  = (uint64_t)intervalUs * nominalUs;
+    int32_t  slew = us2 >= 1000000000000ULL
+                  ? FEED_MAX.raw
+                  : (int32_t)(us2 * Q16::ONE / 1000000ULL * accel_ / 1000000ULL);
+    if (!slew) slew = 1;
+    if (current_ < target_) {
+      current_ = (target_ - current_).raw > slew ? current_ + Q16::fromRaw(slew) : target_;
+    } else {
+      current_ = (current_ - target_).raw > slew ? current_ - Q16::fromRaw(slew) : target_;
+    }
+  }
+  return intervalUs;
+}
@@ -0,0 +1,89 @@
+// src/fixed_point.cpp
+
+#include "fixed_point.h"
+
+//—————————————————————————————————————————————
+// Angles
+//—————————————————————————————————————————————
+
+// sin over one turn in 256 steps (+1 wrap entry), Q15
+static const int16_t SIN_Q15[257] = {
+       0,    804,   1608,   2410,   3212,   4011,   4808,   5602,
+    6393,   7179,   7962,   8739,   9512,  10278,  11039,  11793,
+   12539,  13279,  14010,  14732,  15446,  16151,  16846,  17530,
+   18204,  18868,  19519,  20159,  20787,  21403,  22005,  22594,
+   23170,  23731,  24279,  24811,  25329,  25832,  26319,  26790,
+   27245,  27683,  28105,  28510,  28898,  29268,  29621,  29956,
+   30273,  30571,  30852,  31113,  31356,  31580,  31785,  31971,
+   32137,  32285,  32412,  32521,  32609,  32678,  32728,  32757,
+   32767,  32757,  32728,  32678,  32609,  32521,  32412,  32285,
+   32137,  31971,  31785,  31580,  31356,  31113,  30852,  30571,
+   30273,  29956,  29621,  29268,  28898,  28510,  28105,  27683,
+   27245,  26790,  26319,  25832,  25329,  24811,  24279,  23731,
+   23170,  22594,  22005,  21403,  20787,  20159,  19519,  18868,
+   18204,  17530,  16846,  16151,  15446,  14732,  14010,  13279,
+   12539,  11793,  11039,  10278,   9512,   8739,   7962,   7179,
+    6393,   5602,   4808,   4011,   3212,   2410,   1608,    804,
+       0,   -804,  -1608,  -2410,  -3212,  -4011,  -4808,  -5602,
+   -6393,  -7179,  -7962,  -8739,  -9512, -10278, -11039, -11793,
+  -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530,
+  -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+  -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+  -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956,
+  -30273, -30571, -30852, -31113, -31356, -31580, -31785, -31971,
+  -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+  -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285,
+  -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571,
+  -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+  -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731,
+  -23170, -22594, -22005, -21403, -20787, -20159, -19519, -18868,
+  -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+  -12539, -11793, -11039, -10278,  -9512,  -8739,  -7962,  -7179,
+   -6393,  -5602,  -4808,  -4011,  -3212,  -2410,  -1608,   -804,
+       0,
+};
+
+// atan(2^-i) as binary angles, for CORDIC
+static const uint32_t ATAN_BAM[24] = {
+  0x20000000, 0x12E4051E, 0x09FB385B, 0x051111D4,
+  0x028B0D43, 0x0145D7E1, 0x00A2F61E, 0x00517C55,
+  0x0028BE53, 0x00145F2F, 0x000A2F98, 0x000517CC,
+  0x00028BE6, 0x000145F3, 0x0000A2FA, 0x0000517D,
+  0x000028BE, 0x0000145F, 0x00000A30, 0x00000518,
+  0x0000028C, 0x00000146, 0x000000A3, 0x00000051,
+};
+
+int32_t sinQ15(uint32_t bam) {
+  uint32_t i    = bam >> 24;
+  int32_t  frac = (bam >> 8) & 0xFFFF;
+  int32_t  a = SIN_Q15[i], b = SIN_Q15[i + 1];
+  return a + (((b - a) * frac) >> 16);
+}
+
+int32_t cosQ15(uint32_t bam) {
+  return sinQ15(bam + BAM_QUARTER);
+}
+
+uint32_t atan2Bam(int64_t y, int64_t x) {
+  if (!x && !y) return 0;
+  // scale up so the shifts below keep precision, leaving gain headroom;
+  // doubling, not <<, since x and y may be negative
+  while (x < (1LL << 40) && x > -(1LL << 40) &&
+         y < (1LL << 40) && y > -(1LL << 40)) {
+    x *= 2;
+    y *= 2;
+  }
+  uint32_t ang = 0;
+  // fold into the right half-plane
+  if (x < 0) {
+    int64_t t = x;
+    if (y >= 0) { x =  y; y = -t; ang = BAM_QUARTER; }
+    else        { x = -y; y =  t; ang = (uint32_t)-BAM_QUARTER; }
+  }
+  for (uint8_t i = 0; i < 24; i++) {
+    int64_t xs = x >> i, ys = y >> i;
+    if (y > 0) { x += ys; y -= xs; ang += ATAN_BAM[i]; }
+    else       { x -= ys; y += xs; ang -= ATAN_BAM[i]; }
+  }
+  return ang;
+}
@@ -0,0 +1,231 @@
+// src/gcode.cpp
+
+#include "gcode.h"
+
+static const int64_t GC_NUMBER_MAX   = 1000000000000LL;   // thousandths: 1e9 units
+static const int64_t GC_TRAVEL_MAX_UM = 1000000000LL;     // 1 km either side of origin
+// F above this (1 km/min) is far past any step rate the rig can take, so
+// capping it changes no move; it keeps major · feed_ below 2^63
+static const int64_t GC_FEED_MAX_UM_MIN = 1000000000LL;
+
+// the parser's whole state is these fields; nothing grows with the input
+static_assert(sizeof(GcodeParser) <= 96, "G-code parser state must stay fixed and small");
+
+//—————————————————————————————————————————————
+// Parser
+//—————————————————————————————————————————————
+
+void GcodeParser::reset() {
+  lines_ = 0;
+  state_ = WORD;
+  fresh_ = true;
+}
+
+void GcodeParser::startLine() {
+  line_ = GcodeLine{ 0, 0, -1, -1, -1, 0, 0, 0, 0, 0, ++lines_, GC_OK };
+  state_ = WORD;
+  fresh_ = false;
+}
+
+bool GcodeParser::endLine() {
+  state_ = WORD;
+  fresh_ = true;
+  return true;
+}
+
+void GcodeParser::fail(GcodeError e) {
+  if (!line_.error) line_.error = e;
+  state_ = SKIP;
+}
+
+bool GcodeParser::feed(char c) {
+  if (fresh_) startLine();
+  if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+
+  if (state_ == NUMBER) {
+    if (c >= '0' && c <= '9') {
+      if (point_ && frac_ >= 3) return false;   // finer than a thousandth
+      if (point_) frac_++;
+      num_    = num_ * 10 + (c - '0');
+      digits_ = true;
+      if (num_ > GC_NUMBER_MAX) fail(GC_RANGE);
+      return false;
+    }
+    if (c == '.' && !point_) {
+      point_ = true;
+      return false;
+    }
+    if ((c == '-' || c == '+') && !sign_ && !digits_ && !point_) {
+      sign_ = true;
+      neg_  = c == '-';
+      return false;
+    }
+    if ((c == ' ' || c == '\t') && !sign_ && !digits_ && !point_) return false;
+    endWord();                          // c starts whatever follows
+  }
+
+  if (state_ == PAREN) {
+    if (c == ')') state_ = WORD;
+    return c == '\n' ? endLine() : false;
+  }
+  if (state_ == SKIP) return c == '\n' ? endLine() : false;
+
+  if (c == '\n') return endLine();
+  if (c == ' ' || c == '\t' || c == '\r' || c == '%') return false;
+  if (c == '(') {
+    state_ = PAREN;
+  } else if (c == ';' || c == '*') {    // comment, or a checksum to the end
+    state_ = SKIP;
+  } else if (c >= 'A' && c <= 'Z') {
+    letter_ = c;
+    num_    = 0;
+    frac_   = 0;
+    neg_    = sign_ = digits_ = point_ = false;
+    state_  = NUMBER;
+  } else {
+    fail(GC_SYNTAX);
+  }
+  return false;
+}
+
+void GcodeParser::endWord() {
+  state_ = WORD;
+  if (!digits_) {
+    uint8_t bit = letter_ == 'X' ? GW_X : letter_ == 'Y' ? GW_Y : 0;
+    if (!bit || sign_ || point_ || ((line_.words | line_.bare) & bit)) fail(GC_SYNTAX);
+    else line_.bare |= bit;
+    return;
+  }
+  int64_t v = num_;
+  for (uint8_t k = frac_; k < 3; k++) v *= 10;
+  apply(letter_, neg_ ? -v : v);
+}
+
+void GcodeParser::apply(char letter, int64_t v) {
+  if (letter == 'N') return;
+  if (letter == 'G' || letter == 'M') {
+    if (v < 0 || v % 1000) {            // G0.1 and the like
+      fail(GC_UNSUPPORTED);
+      return;
+    }
+    int64_t code = v / 1000;
+    if (letter == 'M') {
+      if (code != 2 && code != 17 && code != 18 && code != 30) fail(GC_UNSUPPORTED);
+      else if (line_.mcode >= 0)                                fail(GC_SYNTAX);
+      else                                                      line_.mcode = (int8_t)code;
+    } else if (code == 0 || code == 1 || code == 4) {
+      if (line_.motion >= 0) fail(GC_SYNTAX);
+      else                   line_.motion = (int8_t)code;
+    } else if (code == 90 || code == 91) {
+      line_.distance = (int8_t)code;
+    } else if (code != 21) {
+      fail(GC_UNSUPPORTED);
+    }
+    return;
+  }
+
+  uint8_t  bit;
+  int64_t *slot;
+  switch (letter) {
+    case 'X': bit = GW_X; slot = &line_.x; break;
+    case 'Y': bit = GW_Y; slot = &line_.y; break;
+    case 'F': bit = GW_F; slot = &line_.f; break;
+    case 'P': bit = GW_P; slot = &line_.p; break;
+    case 'S': bit = GW_S; slot = &line_.s; break;
+    default:
+      fail(GC_UNSUPPORTED);
+      return;
+  }
+  if ((line_.words | line_.bare) & bit) {
+    fail(GC_SYNTAX);
+    return;
+  }
+  line_.words |= bit;
+  *slot = v;
+}
+
+//—————————————————————————————————————————————
+// Interpreter
+//—————————————————————————————————————————————
+
+void GcodeInterpreter::begin(int64_t pos1, int64_t pos2) {
+  steps_[0] = pos1;
+  steps_[1] = pos2;
+  posUm_[0] = drive_.stepsToUm(pos1);
+  posUm_[1] = drive_.stepsToUm(pos2);
+  feed_     = 0;
+  motion_   = -1;
+  relative_ = false;
+  hold_     = 0;
+}
+
+GcodeError GcodeInterpreter::apply(const GcodeLine &l, PlannerMove &m) {
+  m = PlannerMove{ PLAN_NONE, 0, 0, 0, 0 };
+  if (l.error) return l.error;
+  if (l.mcode >= 0 && l.motion >= 0) return GC_SYNTAX;   // one action per line
+
+  if (l.distance >= 0) relative_ = l.distance == 91;
+  if (l.words & GW_F) {
+    if (l.f <= 0) return GC_RANGE;
+    feed_ = l.f < GC_FEED_MAX_UM_MIN ? l.f : GC_FEED_MAX_UM_MIN;
+  }
+
+  if (l.mcode == 17 || l.mcode == 18) {
+    uint8_t axes = l.words | l.bare;
+    uint8_t sel  = (axes & GW_X ? AXIS1_BIT : 0) | (axes & GW_Y ? AXIS2_BIT : 0);
+    if (!sel) sel = AXIS_ALL;
+    hold_  = l.mcode == 17 ? hold_ | sel : hold_ & ~sel;
+    m.kind = PLAN_HOLD;
+    m.axes = hold_;
+    return GC_OK;
+  }
+  if (l.mcode >= 0) return GC_OK;       // M2/M30: the host ends the stream
+  if (l.bare) return GC_SYNTAX;         // only M17/M18 name an axis alone
+
+  if (l.motion == 4) {
+    int64_t us = l.words & GW_P ? l.p : l.words & GW_S ? l.s * 1000 : 0;
+    if (us < 0 || us > INT32_MAX) return GC_RANGE;   // deadlines compare signed
+    m.kind  = PLAN_DWELL;
+    m.value = (uint32_t)us;
+    return GC_OK;
+  }
+  if (l.motion >= 0) motion_ = l.motion;
+  if (!(l.words & (GW_X | GW_Y))) return GC_OK;
+  if (motion_ < 0) return GC_NO_MOTION;
+  if (motion_ == 1 && !feed_) return GC_NO_FEED;
+
+  int64_t to[2] = { posUm_[0], posUm_[1] };
+  if (l.words & GW_X) to[0] = relative_ ? to[0] + l.x : l.x;
+  if (l.words & GW_Y) to[1] = relative_ ? to[1] + l.y : l.y;
+  for (uint8_t a = 0; a < 2; a++) {
+    if (to[a] > GC_TRAVEL_MAX_UM || to[a] < -GC_TRAVEL_MAX_UM) return GC_RANGE;
+  }
+
+  // targets convert from absolute µm, so rounding never accumulates
+  int64_t  s1 = drive_.umToSteps(to[0]), s2 = drive_.umToSteps(to[1]);
+  int64_t  d1 = s1 - steps_[0], d2 = s2 - steps_[1];
+  uint64_t a1 = d1 < 0 ? -d1 : d1, a2 = d2 < 0 ? -d2 : d2;
+  uint64_t major = a1 > a2 ? a1 : a2;
+  if (major > INT32_MAX) return GC_RANGE;
+  uint64_t dx = to[0] > posUm_[0] ? to[0] - posUm_[0] : posUm_[0] - to[0];
+  uint64_t dy = to[1] > posUm_[1] ? to[1] - posUm_[1] : posUm_[1] - to[1];
+  posUm_[0] = to[0];
+  posUm_[1] = to[1];
+  steps_[0] = s1;
+  steps_[1] = s2;
+  if (!major) return GC_OK;             // under half a step: nothing to run
+
+  uint32_t rate = maxRate_;
+  if (motion_ == 1) {
+    // major-axis rate that moves along the path at feed_ µm/min;
+    // major ≤ INT32_MAX and the feed cap keep the product in range
+    uint64_t len = isqrt64(dx * dx + dy * dy);
+    uint64_t r   = len ? major * (uint64_t)feed_ / (60 * len) : maxRate_;
+    rate = r < 1 ? 1 : r > maxRate_ ? maxRate_ : (uint32_t)r;
+  }
+  m.kind  = PLAN_MOVE;
+  m.d1    = (int32_t)d1;
+  m.d2    = (int32_t)d2;
+  m.value = rate;
+  return GC_OK;
+}
@@ -0,0 +1,123 @@
+// src/input_trace.cpp
+
+#include "input_trace.h"
+#include "crc32.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static InputSample sampleOf(const InputFrame &f, bool connected) {
+  InputSample s;
+  s.tUs      = f.tUs;
+  s.buttons  = (uint16_t)((f.buttons & (BTN_BIT(BTN_COUNT) - 1)) |
+                          (connected ? INPUT_LINK_BIT : 0));
+  s.joyLVert = f.joyLVert;
+  s.joyRHori = f.joyRHori;
+  s.trigLT   = f.trigLT;
+  s.trigRT   = f.trigRT;
+  return s;
+}
+
+static bool sameState(const InputSample &a, const InputSample &b) {
+  return a.buttons == b.buttons && a.joyLVert == b.joyLVert &&
+         a.joyRHori == b.joyRHori && a.trigLT == b.trigLT && a.trigRT == b.trigRT;
+}
+
+void InputTrace::begin(uint32_t nowUs) {
+  head_ = count_ = dropped_ = 0;
+  originUs_  = nowUs;
+  started_   = false;
+  replaying_ = false;
+}
+
+void InputTrace::capture(const InputFrame &f, bool connected) {
+  if (replaying_) return;
+  InputSample s = sampleOf(f, connected);
+  if (started_ && sameState(s, last_)) return;
+  started_ = true;
+  last_    = s;
+  s.tUs   -= originUs_;
+  ring_[head_] = s;
+  head_ = (head_ + 1) % INPUT_TRACE_SLOTS;
+  if (count_ < INPUT_TRACE_SAMPLES) count_++;
+  else dropped_++;
+}
+
+InputSample InputTrace::at(uint32_t i) const {
+  uint32_t first = (head_ + INPUT_TRACE_SLOTS - count_) % INPUT_TRACE_SLOTS;
+  return ring_[(first + i) % INPUT_TRACE_SLOTS];
+}
+
+InputSample InputTrace::tail(uint32_t nowUs) const {
+  InputSample s = last_;
+  s.tUs = nowUs - originUs_;
+  return s;
+}
+
+void InputTrace::load(const InputSample *s, uint32_t n) {
+  if (n > INPUT_TRACE_SLOTS) n = INPUT_TRACE_SLOTS;
+  memcpy(ring_, s, n * sizeof(InputSample));
+  head_      = n % INPUT_TRACE_SLOTS;
+  count_     = n;
+  dropped_   = 0;
+  replaying_ = false;
+}
+
+bool InputTrace::startReplay(uint32_t nowUs) {
+  if (!count_) return false;
+  replaying_ = true;
+  replayUs_  = nowUs;
+  cursor_    = 0;
+  // before the first sample the controller reads as idle and unpaired
+  state_     = InputSample{ 0, 0, 0x8000, 0x8000, 0, 0 };
+  return true;
+}
+
+void InputTrace::replay(InputFrame &f, bool &connected) {
+  if (!replaying_) return;
+  uint32_t offset = f.tUs - replayUs_;
+  while (cursor_ < count_) {
+    InputSample s = at(cursor_);
+    if ((int32_t)(offset - s.tUs) < 0) break;
+    state_ = s;
+    cursor_++;
+  }
+  f.buttons  = state_.buttons & ~INPUT_LINK_BIT;
+  f.joyLVert = state_.joyLVert;
+  f.joyRHori = state_.joyRHori;
+  f.trigLT   = state_.trigLT;
+  f.trigRT   = state_.trigRT;
+  connected  = state_.buttons & INPUT_LINK_BIT;
+  if (cursor_ >= count_) replaying_ = false;
+}
+
+int formatInputSample(char *buf, size_t len, const InputSample &s) {
+  return snprintf(buf, len, "I %lu %04x %u %u %u %u", (unsigned long)s.tUs,
+                  s.buttons, s.joyLVert, s.joyRHori, s.trigLT, s.trigRT);
+}
+
+bool parseInputSample(const char *line, InputSample &s) {
+  unsigned long t;
+  unsigned      b, lv, rh, lt, rt;
+  if (sscanf(line, "I %lu %x %u %u %u %u", &t, &b, &lv, &rh, &lt, &rt) != 6) return false;
+  if (b > 0xffff || lv > 0xffff || rh > 0xffff || lt > 0xffff || rt > 0xffff) return false;
+  s = InputSample{ (uint32_t)t, (uint16_t)b, (uint16_t)lv, (uint16_t)rh,
+                   (uint16_t)lt, (uint16_t)rt };
+  return true;
+}
+
+void writeInputTrace(const InputTrace &t, uint32_t nowUs, TraceLineSink sink, void *ctx) {
+  char     line[48];
+  uint32_t crc = 0;
+  uint32_t n   = t.count() ? t.count() + 1 : 0;
+  snprintf(line, sizeof(line), "TRACE samples=%lu dropped=%lu", (unsigned long)n,
+           (unsigned long)t.dropped());
+  sink(line, ctx);
+  for (uint32_t i = 0; i < n; i++) {
+    int len = formatInputSample(line, sizeof(line), i < t.count() ? t.at(i) : t.tail(nowUs));
+    crc = crc32Update(crc, line, len);
+    sink(line, ctx);
+  }
+  snprintf(line, sizeof(line), "TRACE END crc=%08lx", (unsigned long)crc);
+  sink(line, ctx);
+}
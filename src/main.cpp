@@ -4,6 +4,31 @@
 #include <M5Unified.h>
 #include <Preferences.h>
 #include <XboxSeriesXControllerESP32_asukiaaa.hpp>
+#include <soc/gpio_struct.h>
+
+#include "axis_position.h"
+#include "cobs_frame.h"
+#include "command_protocol.h"
+#include "controller_input.h"
+#include "coop_scheduler.h"
+#include "cycle_stats.h"
+#include "deferred_log.h"
+#include "diff_drive.h"
+#include "feed_override.h"
+#include "gcode.h"
+#include "input_trace.h"
+#include "latency_trace.h"
+#include "link_guard.h"
+#include "move_planner.h"
+#include "odometry.h"
+#include "rate_stepper.h"
+#include "robot_config.h"
+#include "segment.h"
+#include "segment_stream.h"
+#include "shell_line.h"
+#include "step_schedule.h"
+#include "stick_curve.h"
+#include "telemetry.h"
 
 using namespace XboxSeriesXControllerESP32_asukiaaa;
 
@@ -14,29 +39,148 @@ using namespace XboxSeriesXControllerESP32_asukiaaa;
 Preferences         preferences;
 Core                xbox;
 
-// Motor 1 pins
-static const int    ENABLE1_PIN   = 5;
-static const int    DIR1_PIN      = 17;
-static const int    STEP1_PIN     = 16;
+// pins, geometry and motion defaults: robot_config.h
+static const uint32_t ESTOP_ENABLE_MASK = (1UL << ENABLE1_PIN) | (1UL << ENABLE2_PIN);
+
+static const uint32_t SERIAL_BAUD = 115200;    // 921600 to carry 1 kHz telemetry
+
+static const uint32_t INPUT_POLL_US  = 10000;   // controller poll cadence while moving
+static const uint32_t LINK_SETTLE_MS = 500;     // reconnection must hold this long
+static const uint32_t LOOP_IDLE_US   = 5000;    // rest between loop() passes
+static const uint32_t DISPLAY_REFRESH_US = 200000;
+static const uint32_t BANNER_US      = 800000;  // CONNECTED! stays up this long
+static const uint32_t BOOT_SETTLE_US = 200000;
+
+// motor 1 = left wheel, motor 2 = right wheel
+constexpr DiffDrive   drive(STEPS_PER_REV, WHEEL_DIA_MM, TRACK_MM);
+
+// return-to-origin as a rig (one straight move in wheel/axis space) or,
+// set to 1, as a robot (turn, drive, turn back using odometry)
+#define              RETURN_VIA_ODOMETRY 0
+
+// live drive: full stick commands these body speeds
+static const int32_t  LIVE_MAX_V_MM_S    = 80;
+static const int32_t  LIVE_MAX_W_MRAD_S  = 1000;
+static const uint8_t  LIVE_MAX_STEPS     = 4;    // per loop() pass, per axis
 
-// Motor 2 pins (Grove A & B)
-static const int    ENABLE2_PIN   = 21;
-static const int    DIR2_PIN      = 22;
-static const int    STEP2_PIN     = 26;
+// stick response profiles, cycled with LS: speed (left Y) and turn
+// (right X) tables; the first keeps the old 0.4–0.6 dead band, linear
+struct StickProfile {
+  const char *name;
+  StickTable  v, w;
+};
+static constexpr StickProfile STICK_PROFILES[] = {
+  { "LINEAR", makeStickTable({ 20,  0, false }, LIVE_MAX_V_MM_S),
+              makeStickTable({ 20,  0, false }, LIVE_MAX_W_MRAD_S) },
+  { "SOFT",   makeStickTable({ 12, 50, false }, LIVE_MAX_V_MM_S),
+              makeStickTable({ 12, 60, false }, LIVE_MAX_W_MRAD_S) },
+  { "FINE",   makeStickTable({  8, 85, false }, LIVE_MAX_V_MM_S),
+              makeStickTable({  8, 90, false }, LIVE_MAX_W_MRAD_S) },
+};
+static const uint8_t  STICK_PROFILE_COUNT =
+  sizeof(STICK_PROFILES) / sizeof(STICK_PROFILES[0]);
+
+// motion settings the serial shell can change at run time; the constants
+// above are the defaults. Changes are staged whole and adopted between
+// steps (adoptParams), never half-applied.
+struct MotionParams {
+  uint32_t pulseUs;         // STEP high time; a step takes twice this
+  uint32_t accel;           // steps/s²: ramps, stops and wind-downs
+  uint32_t safeRate;        // steps/s for planned moves and G0
+  uint32_t gapUs;           // settle time after each segment, PLAY_ONCE
+  uint32_t liveSteps;       // live-drive steps per loop() pass, per axis
+  uint32_t segLimit;        // recording keeps at most this many segments
+  uint32_t deadPct;         // dead band and expo of the TUNED stick profile
+  uint32_t expoPct;
+};
+static const MotionParams DEFAULT_PARAMS = {
+  STEP_DELAY_US, MAX_ACCEL_STEPS_S2, MAX_SAFE_RATE, SEGMENT_GAP_US,
+  LIVE_MAX_STEPS, MAX_SEGMENTS, 20, 0,
+};
 
-static const int    STEP_DELAY_US = 200;
-#define              MAX_SEGMENTS  100
+struct ParamBinding {
+  const char *name;
+  uint32_t MotionParams::*field;
+  uint32_t    min, max;
+  const char *unit;
+};
 
-struct Segment {
-  int8_t           dir1, dir2;
-  long             pulses1, pulses2;
-  unsigned long    durationMs;
+static const ParamBinding PARAM_MAP[] = {
+  { "pulse_us",   &MotionParams::pulseUs,   5,   1000,    "us" },
+  { "accel",      &MotionParams::accel,     100, 100000,  "steps/s2" },
+  { "safe_rate",  &MotionParams::safeRate,  1,   20000,   "steps/s" },
+  { "gap_us",     &MotionParams::gapUs,     0,   5000000, "us" },
+  { "live_steps", &MotionParams::liveSteps, 1,   32,      "steps" },
+  { "seg_limit",  &MotionParams::segLimit,  1,   MAX_SEGMENTS, "segments" },
+  { "dead",       &MotionParams::deadPct,   0,   90,      "%" },
+  { "expo",       &MotionParams::expoPct,   0,   100,     "%" },
 };
 
+// keep the compiled schedule in NVS next to the recording, up to
+// SCHEDULE_PERSIST_MAX bytes; a larger one (long mask arena) is left out
+// and recompiled at load, so NVS never has to hold the 16 KB arena
+#define              PERSIST_SCHEDULE 1
+#define              SCHEDULE_PERSIST_MAX 4096
+
 Segment             segments[MAX_SEGMENTS];
 uint16_t            segmentCount   = 0;
+StepSchedule        schedule;                 // compiled form of segments[]
+bool                scheduleValid  = false;
 bool                recordingMode  = false;
 bool                playbackMode   = false;
+volatile bool       abortRequested = false;   // motion winds down, then stops
+volatile bool       estopLatched   = false;   // drivers forced off until cleared
+volatile uint32_t   estopAtUs      = 0;       // ISR entry time
+volatile uint32_t   estopCycles    = 0;       // ISR entry → ENA pins HIGH
+uint32_t            estopSeenUs    = 0;       // motion loop noticed it
+bool                estopReported  = false;
+FeedOverride        feed(MAX_ACCEL_STEPS_S2, MIN_STEP_INTERVAL_US);
+uint8_t             dirState = 0xFF, enState = 0xFF;   // last DIR/ENA written
+AxisPositions       positions;                // absolute steps from origin
+RateStepper         liveStepper;              // live-drive step timing
+int64_t             homePos1 = 0, homePos2 = 0;   // start of the recorded path
+Odometry            odom(STEPS_PER_REV, WHEEL_DIA_MM, TRACK_MM);
+int64_t             homeXUm = 0, homeYUm = 0;     // pose at the path start
+uint32_t            homeHeading = 0;
+
+// continuous playback
+enum PlayMode : uint8_t { PLAY_ONCE, PLAY_LOOP, PLAY_PINGPONG };
+static const uint32_t LOOP_PRESETS[]     = { 0, 10, 100, 1000 };   // 0 = forever
+static const uint32_t STATS_REPORT_CYCLES = 10;
+PlayMode            playMode       = PLAY_ONCE;
+uint8_t             loopPreset     = 0;
+uint32_t            loopCycles     = LOOP_PRESETS[0];
+CycleStats          cycleStats;
+uint8_t             stickProfile   = 0;       // index into STICK_PROFILES, or TUNED
+MotionParams        params         = DEFAULT_PARAMS;   // in effect
+MotionParams        pendingParams  = DEFAULT_PARAMS;   // staged by the shell
+bool                paramsPending  = false;
+StickProfile        tunedStick     = { "TUNED", {}, {} };   // built from params
+
+// progress through one pass of the schedule
+struct RunProgress {
+  uint32_t ticks;                       // ticks output, dwells included
+  uint16_t segment;                     // segment of the last one
+  uint32_t steps;                       // step ticks into that segment
+};
+
+// a run stopped by a controller drop, enough to continue it exactly
+struct PlaybackSnapshot {
+  bool        valid;
+  bool        reverse;                  // direction the run started in
+  bool        secondLeg;                // ping-pong: stopped on the way back
+  PlayMode    mode;
+  uint32_t    loopCycles;
+  uint32_t    cycles;                   // cycles already completed
+  RunProgress at;                       // where the pass came to rest
+  uint32_t    stamp;                    // schedule it belongs to
+  int64_t     pos1, pos2;               // axis positions at rest
+};
+PlaybackSnapshot    paused         = {};
+
+const char *playModeName(PlayMode m) {
+  return m == PLAY_LOOP ? "LOOP" : m == PLAY_PINGPONG ? "PING" : "ONCE";
+}
 
 // live‐drive tracking for recording
 volatile long       stepCount1     = 0;
@@ -45,34 +189,309 @@ unsigned long       segStartTime   = 0;
 long                segStartCount1, segStartCount2;
 int8_t              lastDir1 = 0, lastDir2 = 0;
 
-// button‐edge storage
-bool                lastLB=false, lastRB=false;
-bool                lastA=false,  lastB=false;
-bool                lastX=false,  lastY=false;
-bool                lastBack=false, lastStart=false;
+// packed buttons, edges and handler dispatch
+InputLayer          input;
+LatencyTrace        latency;                  // input → first STEP edge
+InputTrace          inputTrace;               // controller capture since boot
+DeferredLog         dlog;                     // status lines, written off the motion path
+MotionTelemetry     telemetry;                // binary motion state stream
+static const uint32_t TELEMETRY_RATES[] = { 0, 100, 250, 1000 };   // Hz, cycled with M
+uint8_t             telemetryPreset = 0;
+FrameReader         hostRx;                   // command frames off Serial
+ShellLine           shell;                    // text commands off Serial
+SegmentQueue        streamQueue;              // live segments from the host
+SegmentStream       stream;
+GcodeParser         gcodeParser;              // host G-code, a character at a time
+GcodeInterpreter    gcode(drive, MAX_SAFE_RATE);
+MoveQueue           moveQueue;                // planner moves from the G-code
+MoveStream          moves;
+bool                streamActive   = false;
+bool                gcodeStream    = false;   // the stream is G-code, not segments
+uint32_t            streamReported = 0;       // completed count last sent
+uint16_t            uploadTotal = 0, uploadNext = 0;
+bool                hostReverse    = false;   // direction for a host PLAY
+LinkGuard           controllerLink(LINK_SETTLE_MS);
+bool                runLinkLost    = false;   // current run stopped by a drop
+bool                bannerDue      = false;   // show CONNECTED! when idle
+bool                bannerUp       = false;   // showing it: no refreshes
+bool                displayDirty   = false;   // redraw at the next idle pass
+WheelRates          liveRates      = { 0, 0 };   // last live-drive command
+
+// cooperative tasks, run inside yieldUntil() waits (TASK_MAP, by setup())
+enum TaskId : uint8_t {
+  TASK_INPUT,                           // controller and host, during runs
+  TASK_DISPLAY,
+  TASK_BANNER,                          // one-shot: CONNECTED! times out
+#ifndef ESP_PLATFORM
+  TASK_BACKGROUND,                      // log and telemetry out, no tasks here
+#endif
+  TASK_COUNT
+};
+CoopScheduler       sched([]() -> uint32_t { return (uint32_t)micros(); });
 
 //—————————————————————————————————————————————
 // Low‐Level Motor Control
 //—————————————————————————————————————————————
 
-void doStep1() {
-  digitalWrite(STEP1_PIN, HIGH);
-  delayMicroseconds(STEP_DELAY_US);
-  digitalWrite(STEP1_PIN, LOW);
-  delayMicroseconds(STEP_DELAY_US);
-  stepCount1++;
+void enable1(bool en) { digitalWrite(ENABLE1_PIN, en ? LOW : HIGH); }
+void enable2(bool en) { digitalWrite(ENABLE2_PIN, en ? LOW : HIGH); }
+
+// write DIR/ENA levels (AXISn_BIT masks), touching only changed pins;
+// a latched e-stop keeps every driver off, even one that lands between
+// the check and the pin writes
+void setAxes(uint8_t dirBits, uint8_t enableBits) {
+  if (estopLatched) enableBits = 0;
+  if (dirBits != dirState) {
+    digitalWrite(DIR1_PIN, (dirBits & AXIS1_BIT) ? HIGH : LOW);
+    digitalWrite(DIR2_PIN, (dirBits & AXIS2_BIT) ? HIGH : LOW);
+    dirState = dirBits;
+  }
+  if (enableBits != enState) {
+    enable1(enableBits & AXIS1_BIT);
+    enable2(enableBits & AXIS2_BIT);
+    enState = enableBits;
+    if (estopLatched) {                 // onEStop ran mid-write: undo it
+      GPIO.out_w1ts = ESTOP_ENABLE_MASK;
+      enState = 0;
+    }
+  }
+}
+
+void disableAxes() { setAxes(dirState, 0); }
+
+// wait for a micros() deadline, handing the time to scheduler tasks that
+// fit in it: sleeps through long stretches, spins the last ones so the
+// deadline holds. strict keeps late critical tasks out too, for pulse
+// timing. Returns false early once *cancel turns true.
+bool yieldUntil(unsigned long dueUs, const volatile bool *cancel = nullptr,
+                bool strict = false) {
+  for (;;) {
+    if (cancel && *cancel) return false;
+    long left = (long)(dueUs - micros());
+    if (left <= 0) return true;
+    if (sched.runNext((uint32_t)left, strict)) continue;
+    uint32_t idle = sched.untilNext(strict);
+    if (idle > (uint32_t)left) idle = (uint32_t)left;
+    if (idle >= 2000) delay(idle / 1000);
+    else              delayMicroseconds(idle);
+  }
 }
 
-void doStep2() {
-  digitalWrite(STEP2_PIN, HIGH);
-  delayMicroseconds(STEP_DELAY_US);
-  digitalWrite(STEP2_PIN, LOW);
-  delayMicroseconds(STEP_DELAY_US);
-  stepCount2++;
+// simultaneous STEP pulse on every axis in mask
+void pulseAxes(uint8_t mask) {
+  if (mask & AXIS1_BIT) digitalWrite(STEP1_PIN, HIGH);
+  if (mask & AXIS2_BIT) digitalWrite(STEP2_PIN, HIGH);
+  uint32_t now = micros();
+  latency.step(now);
+  telemetry.step(mask, now);
+  yieldUntil(now + params.pulseUs, nullptr, true);
+  if (mask & AXIS1_BIT) digitalWrite(STEP1_PIN, LOW);
+  if (mask & AXIS2_BIT) digitalWrite(STEP2_PIN, LOW);
+  positions.step(mask, dirState);
 }
 
-void enable1(bool en) { digitalWrite(ENABLE1_PIN, en ? LOW : HIGH); }
-void enable2(bool en) { digitalWrite(ENABLE2_PIN, en ? LOW : HIGH); }
+// BtnC falling edge: ENA HIGH on both drivers in one register write, no
+// matter what loop() or the BLE stack are doing, then latch the fault
+void IRAM_ATTR onEStop() {
+  uint32_t c0 = ESP.getCycleCount();
+  GPIO.out_w1ts = ESTOP_ENABLE_MASK;
+  uint32_t c1 = ESP.getCycleCount();
+  if (!estopLatched) {
+    estopCycles = c1 - c0;
+    estopAtUs   = micros();
+  }
+  estopLatched   = true;
+  abortRequested = true;
+}
+
+// full live-drive step (pulse + low time), counted for recording
+void liveStep(uint8_t mask) {
+  pulseAxes(mask);
+  yieldUntil(micros() + params.pulseUs, nullptr, true);
+  if (mask & AXIS1_BIT) stepCount1++;
+  if (mask & AXIS2_BIT) stepCount2++;
+}
+
+// fold wheel motion since the last call into the pose
+void updateOdometry() {
+  int64_t p1, p2;
+  positions.read(p1, p2);
+  odom.update(p1, p2);
+}
+
+// poll the controller into an input frame, stamped on receipt
+InputFrame readController() {
+  xbox.onLoop();
+  const XboxControllerNotificationParser &n = xbox.xboxNotif;
+  InputFrame f;
+  f.tUs     = micros();
+  latency.poll(f.tUs);
+  telemetry.poll(f.tUs);
+  f.buttons = (n.btnLB       ? BTN_BIT(BTN_LB)    : 0) |
+              (n.btnRB       ? BTN_BIT(BTN_RB)    : 0) |
+              (n.btnSelect   ? BTN_BIT(BTN_BACK)  : 0) |
+              (n.btnStart    ? BTN_BIT(BTN_START) : 0) |
+              (n.btnA        ? BTN_BIT(BTN_A)     : 0) |
+              (n.btnB        ? BTN_BIT(BTN_B)     : 0) |
+              (n.btnX        ? BTN_BIT(BTN_X)     : 0) |
+              (n.btnY        ? BTN_BIT(BTN_Y)     : 0) |
+              (n.btnDirUp    ? BTN_BIT(BTN_UP)    : 0) |
+              (n.btnDirRight ? BTN_BIT(BTN_RIGHT) : 0) |
+              (n.btnDirLeft  ? BTN_BIT(BTN_LEFT)  : 0) |
+              (n.btnDirDown  ? BTN_BIT(BTN_DOWN)  : 0) |
+              (n.btnLS       ? BTN_BIT(BTN_LS)    : 0);
+  f.joyLVert = n.joyLVert;
+  f.joyRHori = n.joyRHori;
+  f.trigLT   = n.trigLT;
+  f.trigRT   = n.trigRT;
+  return f;
+}
+
+// controller dropped: release every button, centre the sticks and wind
+// down any run (bounded by the fastest step rate / MAX_ACCEL_STEPS_S2,
+// about 0.63 s)
+void onLinkLost(uint32_t tUs) {
+  dlog.log("!! CONTROLLER LOST\n");
+  input.update(InputFrame{ tUs, 0, 0x8000, 0x8000, 0, 0 });
+  if (playbackMode && !abortRequested) {
+    abortRequested = true;
+    runLinkLost    = true;
+  }
+}
+
+void onLinkUp() {
+  dlog.log("> CONTROLLER CONNECTED\n");
+  bannerDue = true;
+}
+
+// poll, follow the link state and dispatch button edges while it is up;
+// also used inside motion loops. A trace replay stands in for the pad.
+const InputFrame &readInput() {
+  InputFrame f = readController();
+  bool connected = xbox.isConnected();
+  if (inputTrace.replaying()) inputTrace.replay(f, connected);
+  else                        inputTrace.capture(f, connected);
+  switch (controllerLink.update(connected, millis())) {
+    case LINK_LOST: onLinkLost(f.tUs); break;
+    case LINK_UP:   onLinkUp();        break;
+    default:                           break;
+  }
+  if (controllerLink.up()) input.update(f);
+  return input.frame();
+}
+
+//—————————————————————————————————————————————
+// Background Output
+//—————————————————————————————————————————————
+
+void writeLogLine(const char *line, size_t len) {
+  Serial.write((const uint8_t *)line, len);
+}
+
+// command replies and stream events: short, so written even if that
+// means waiting on the UART for a moment
+void sendFrame(uint8_t type, const uint8_t *payload, size_t len) {
+  uint8_t frame[COBS_FRAME_MAX(COMMAND_PAYLOAD_MAX)];
+  Serial.write(frame, frameEncode(type, payload, len, frame));
+}
+
+uint16_t motionFlags() {
+  return (recordingMode                   ? TLM_RECORDING : 0) |
+         (playbackMode                    ? TLM_PLAYBACK  : 0) |
+         (playbackMode && abortRequested  ? TLM_STOPPING  : 0) |
+         (estopLatched                    ? TLM_ESTOP     : 0) |
+         (controllerLink.up()             ? TLM_LINK      : 0) |
+         (inputTrace.replaying()          ? TLM_REPLAY    : 0) |
+         (streamActive                    ? TLM_STREAM    : 0);
+}
+
+// one telemetry frame if due; skipped, not queued, when the UART has no
+// room for all of it
+void sendTelemetry() {
+  TelemetrySample s;
+  if (!telemetry.sample(micros(), s)) return;
+  int64_t p1, p2;
+  positions.read(p1, p2);
+  s.pos[0]     = (int32_t)p1;
+  s.pos[1]     = (int32_t)p2;
+  s.feed       = feed.current().raw;
+  s.dirBits    = dirState;
+  s.enableBits = enState;
+  s.flags      = motionFlags();
+
+  uint8_t payload[TELEMETRY_SAMPLE_BYTES];
+  uint8_t frame[COBS_FRAME_MAX(TELEMETRY_SAMPLE_BYTES)];
+  size_t  n = frameEncode(TELEMETRY_FRAME_SAMPLE, payload, packTelemetry(s, payload), frame);
+  if (Serial.availableForWrite() < (int)n) {
+    telemetry.skipped();
+    return;
+  }
+  Serial.write(frame, n);
+}
+
+#ifdef ESP_PLATFORM
+// below the BLE stack on core 0: formatting and UART waits stay off the
+// core that runs loop() and the step timing
+void logDrainTask(void *) {
+  for (;;) {
+    if (!dlog.drain(writeLogLine)) vTaskDelay(pdMS_TO_TICKS(5));
+  }
+}
+
+// wakes every 1 ms tick; sample() keeps the configured rate
+void telemetryTask(void *) {
+  TickType_t wake = xTaskGetTickCount();
+  for (;;) {
+    sendTelemetry();
+    vTaskDelayUntil(&wake, 1);
+  }
+}
+#else
+// no background tasks off the device: TASK_BACKGROUND drains the log and
+// streams telemetry from inside the waits, motion included
+void serviceBackground() {
+  dlog.drain(writeLogLine);
+  sendTelemetry();
+}
+#endif
+
+//—————————————————————————————————————————————
+// Motion Parameters
+//—————————————————————————————————————————————
+
+// the first field out of range, or the pair that cannot hold together;
+// nullptr if the set is usable
+const char *paramsProblem(const MotionParams &p) {
+  for (const ParamBinding &b : PARAM_MAP) {
+    if (p.*b.field < b.min || p.*b.field > b.max) return b.name;
+  }
+  // a step takes 2 × pulse_us, which caps the planned rate
+  if ((uint64_t)p.safeRate * 2 * p.pulseUs > 1000000) return "safe_rate with pulse_us";
+  return nullptr;
+}
+
+const StickProfile &liveStick() {
+  return stickProfile < STICK_PROFILE_COUNT ? STICK_PROFILES[stickProfile] : tunedStick;
+}
+
+void buildTunedStick() {
+  StickShape shape = { (uint8_t)params.deadPct, (uint8_t)params.expoPct, false };
+  tunedStick.v = makeStickTable(shape, LIVE_MAX_V_MM_S);
+  tunedStick.w = makeStickTable(shape, LIVE_MAX_W_MRAD_S);
+}
+
+// switch to the staged set in one go. Runs only between steps (runTicks
+// and loop()), so no step sees half a change; a move already planned
+// keeps the profile it started with.
+void adoptParams() {
+  bool stick = pendingParams.deadPct != params.deadPct ||
+               pendingParams.expoPct != params.expoPct;
+  params        = pendingParams;
+  paramsPending = false;
+  feed.setLimits(params.accel, 2 * params.pulseUs);
+  if (stick) buildTunedStick();
+  dlog.log("Parameters applied\n");
+}
 
 //—————————————————————————————————————————————
 // Recording & Playback
@@ -89,39 +508,143 @@ void startSegment(int8_t d1, int8_t d2) {
 }
 
 void recordSegment(int8_t d1, int8_t d2) {
-  if (segmentCount >= MAX_SEGMENTS) return;
+  if (segmentCount >= params.segLimit) return;
   unsigned long dur = millis() - segStartTime;
   long p1 = stepCount1 - segStartCount1;
   long p2 = stepCount2 - segStartCount2;
   if (d1!=0 || d2!=0) {
     segments[segmentCount++] = { d1, d2, p1, p2, dur };
-    Serial.printf("Recorded #%u: d1=%d p1=%ld d2=%d p2=%ld t=%lums\n",
-                  segmentCount, d1, p1, d2, p2, dur);
+    scheduleValid = false;
+    Twist tw = drive.segmentTwist(segments[segmentCount - 1]);
+    updateOdometry();
+    Pose  ps = odom.pose();
+    dlog.log("Recorded #%lu: d1=%ld p1=%ld d2=%ld p2=%ld t=%lums "
+             "v=%ldmm/s w=%ldmrad/s at %ld,%ldmm %ldmrad\n",
+             segmentCount, d1, p1, d2, p2, dur, (long)tw.v, (long)tw.w,
+                  (long)ps.xMm, (long)ps.yMm, (long)ps.thetaMrad);
   }
   startSegment(d1, d2);
 }
 
+// one live-drive pass at the given wheel rates: records on direction
+// change and steps whatever is due
+void driveLive(WheelRates r) {
+  int8_t d1 = r.left  > 0 ? 1 : r.left  < 0 ? -1 : 0;
+  int8_t d2 = r.right > 0 ? 1 : r.right < 0 ? -1 : 0;
+
+  // record on direction change
+  if (recordingMode && (d1!=lastDir1 || d2!=lastDir2)) {
+    recordSegment(lastDir1, lastDir2);
+    startSegment(d1, d2);
+  }
+  lastDir1=d1; lastDir2=d2;
+
+  setAxes((d1>0 ? AXIS1_BIT : 0) | (d2>0 ? AXIS2_BIT : 0),
+          (d1 ? AXIS1_BIT : 0) | (d2 ? AXIS2_BIT : 0));
+  liveRates = r;
+  liveStepper.setRates(r.left, r.right);
+  telemetry.rates(r.left, r.right);
+  for (uint32_t i = 0; i < params.liveSteps; i++) {
+    uint8_t mask = liveStepper.due(micros());
+    if (!mask) break;
+    liveStep(mask);
+  }
+  updateOdometry();
+}
+
+// controller gone: bring the live wheel rates down at params.accel,
+// keeping their ratio (and so the arc), instead of holding the last command
+WheelRates windDown(WheelRates r, uint32_t dtUs) {
+  int32_t m = max(abs(r.left), abs(r.right));
+  if (!m) return r;
+  int32_t dv = (int32_t)((uint64_t)params.accel * dtUs / 1000000UL);
+  if (dv < 1) dv = 1;
+  int32_t n = m > dv ? m - dv : 0;
+  return { (int32_t)((int64_t)r.left * n / m), (int32_t)((int64_t)r.right * n / m) };
+}
+
+// compile segments[] into the flat step schedule unless it is current
+void prepareSchedule() {
+  if (scheduleValid) return;
+  unsigned long t0 = micros();
+  compileSchedule(schedule, segments, segmentCount);
+  scheduleValid = true;
+  dlog.log("Compiled %lu segments: %lu mask bytes in %luus\n",
+           segmentCount, (unsigned long)schedule.maskBytes, micros() - t0);
+}
+
 void saveToFlash() {
   preferences.begin("robocan", false);
   preferences.putUShort("count", segmentCount);
   preferences.putBytes("data", segments,
                        sizeof(Segment) * segmentCount);
+#if PERSIST_SCHEDULE
+  prepareSchedule();
+  uint32_t schedBytes = scheduleStoredSize(schedule);
+  // a failed or skipped write must not leave an older schedule behind
+  if (schedBytes > SCHEDULE_PERSIST_MAX ||
+      preferences.putBytes("sched", &schedule, schedBytes) != schedBytes) {
+    preferences.remove("sched");
+    dlog.log("Compiled schedule not kept (%lu bytes): recompiled at load\n",
+             (unsigned long)schedBytes);
+  }
+#endif
   preferences.end();
-  Serial.printf("Saved %u segments\n", segmentCount);
+  dlog.log("Saved %lu segments\n", segmentCount);
 }
 
 void loadFromFlash() {
   preferences.begin("robocan", true);
   segmentCount = preferences.getUShort("count", 0);
   if (segmentCount > MAX_SEGMENTS) segmentCount = 0;
+  scheduleValid = false;
   if (segmentCount) {
     preferences.getBytes("data", segments,
                          sizeof(Segment) * segmentCount);
-    Serial.printf("Loaded %u segments\n", segmentCount);
+    dlog.log("Loaded %lu segments\n", segmentCount);
+#if PERSIST_SCHEDULE
+    size_t len = preferences.getBytesLength("sched");
+    if (len && len <= sizeof(schedule)) {
+      preferences.getBytes("sched", &schedule, len);
+      scheduleValid = scheduleMatches(schedule, segments, segmentCount) &&
+                      len == scheduleStoredSize(schedule);
+      if (scheduleValid) dlog.log("Loaded compiled schedule\n");
+    }
+#endif
   } else {
-    Serial.println("No saved segments");
+    dlog.log("No saved segments\n");
+  }
+  preferences.end();
+}
+
+// settings live in their own namespace so deleting segments keeps them
+void saveSettings() {
+  preferences.begin("robocan_cfg", false);
+  preferences.putUChar("stick", stickProfile);
+  preferences.end();
+}
+
+// only on request from the shell: tuning is tried out before it is kept
+void saveParams() {
+  preferences.begin("robocan_cfg", false);
+  preferences.putBytes("params", &params, sizeof(params));
+  preferences.end();
+  dlog.log("Saved parameters\n");
+}
+
+void loadSettings() {
+  MotionParams p = DEFAULT_PARAMS;
+  preferences.begin("robocan_cfg", true);
+  stickProfile = preferences.getUChar("stick", 0);
+  if (preferences.getBytesLength("params") == sizeof(p)) {
+    preferences.getBytes("params", &p, sizeof(p));
   }
   preferences.end();
+  if (stickProfile > STICK_PROFILE_COUNT) stickProfile = 0;
+  if (paramsProblem(p)) p = DEFAULT_PARAMS;   // saved by another build
+  params = pendingParams = p;
+  feed.setLimits(params.accel, 2 * params.pulseUs);
+  buildTunedStick();
 }
 
 void deleteSegmentsFromFlash() {
@@ -129,70 +652,326 @@ void deleteSegmentsFromFlash() {
   preferences.clear();                  // removes all keys in this namespace
   preferences.end();
   segmentCount = 0;
-  Serial.println("Deleted all saved segments");
+  scheduleValid = false;
+  dlog.log("Deleted all saved segments\n");
+}
+
+void serviceHost(bool inMotion);        // Host Commands, below
+
+// controller poll from inside a motion loop (TASK_INPUT): X raises
+// abortRequested through its handler, triggers set the feed override.
+// Host frames are read here too, so STOP and stream pushes land mid-run.
+void pollDuringMotion() {
+  serviceHost(true);
+  updateOdometry();
+  const InputFrame &f = readInput();
+  feed.setTarget(FeedOverride::fromTriggers(
+    f.trigLT, f.trigRT, XboxControllerNotificationParser::maxTrig));
+}
+
+// drive a tick stream (compiled schedule or planned move) out to the
+// motors; scaled applies the feed override. Input is polled every
+// INPUT_POLL_US by TASK_INPUT, inside the waits between ticks, never at
+// the cost of a tick's deadline. On abortRequested the stream keeps its
+// path but decelerates to rest at params.accel. prog, if given,
+// counts the ticks actually output. Returns false when aborted.
+template <class Source>
+bool runTicks(Source &src, bool scaled, uint32_t &plannedUs,
+              RunProgress *prog = nullptr) {
+  StepTick t;
+  StopRamp stop;
+  bool     stopping = false;
+  unsigned long due = micros();
+  bool     polling = sched.active(TASK_INPUT);   // nested run: keep its poll
+  if (!polling) sched.start(TASK_INPUT, INPUT_POLL_US);
+  latency.enqueue(due);
+
+  while (src.next(t)) {
+    if (paramsPending) adoptParams();
+    // a dwell or a direction change is a stop in the recording anyway
+    if (abortRequested && (!t.mask || t.dirBits != dirState)) break;
+    if (!yieldUntil(due, &abortRequested)) {
+      if (!t.mask || t.dirBits != dirState) break;
+      yieldUntil(due);                  // ramp down from this tick
+    }
+    if (estopLatched) {                 // drivers are off: stop counting steps
+      if (!estopSeenUs) estopSeenUs = micros();
+      break;
+    }
+    unsigned long t0 = micros();
+    setAxes(t.dirBits, t.enableBits);   // changes only at block boundaries
+    if (t.mask) pulseAxes(t.mask);
+    if (prog) {
+      if (t.block != prog->segment) {
+        prog->segment = t.block;
+        prog->steps   = 0;
+      }
+      prog->ticks++;
+      if (t.mask) prog->steps++;
+    }
+
+    // absolute deadlines keep cycle time from drifting with loop overhead;
+    // catching up after a stall never squeezes pulses below the minimum
+    uint32_t intervalUs = scaled ? feed.apply(t.intervalUs, t.mask != 0)
+                                 : t.intervalUs;
+    if (abortRequested) {
+      if (!stopping) {
+        stopping = true;
+        stop.begin(intervalUs, params.accel);
+      }
+      uint32_t rampUs;
+      if (!stop.next(rampUs)) break;
+      if (rampUs > intervalUs) intervalUs = rampUs;
+    }
+    plannedUs += intervalUs;
+    telemetry.tick(t.mask, intervalUs);
+    due += intervalUs;
+    if (t.mask && (long)(due - (t0 + 2 * params.pulseUs)) < 0) {
+      due = t0 + 2 * params.pulseUs;
+    }
+  }
+  yieldUntil(due);
+  if (!polling) sched.stop(TASK_INPUT);
+  telemetry.idle();
+  updateOdometry();
+  return !abortRequested;
+}
+
+// one pass over the compiled schedule, continuing after the prog.ticks
+// already output (0 = from the start); DIR/ENA levels carry over between
+// passes
+bool runSchedule(bool reverse, uint32_t gapUs, uint32_t &plannedUs,
+                 RunProgress &prog) {
+  ScheduleCursor cursor;
+  cursor.begin(schedule, reverse, gapUs);
+  // replaying the cursor rebuilds its interleave state exactly
+  StepTick t;
+  for (uint32_t i = 0; i < prog.ticks && cursor.next(t); i++) {}
+  return runTicks(cursor, true, plannedUs, &prog);
+}
+
+// planned straight move to an absolute position at params.safeRate
+bool goToPosition(int64_t target1, int64_t target2) {
+  int64_t p1, p2;
+  positions.read(p1, p2);
+  LinearMove move;
+  if (!move.begin(target1 - p1, target2 - p2, params.safeRate, params.accel)) {
+    dlog.log("Move out of range\n");
+    return false;
+  }
+  if (!move.ticks()) return true;
+
+  dlog.log("> GOTO %ld,%ld (%lu steps)\n", (long)target1, (long)target2,
+           (unsigned long)move.ticks());
+  playbackMode   = true;
+  abortRequested = false;
+  uint32_t planned = 0;
+  unsigned long t0 = micros();
+  bool ok = runTicks(move, false, planned);
+  disableAxes();
+  playbackMode = false;
+  dlog.log("Move %s in %lums (planned %lums)\n", ok ? "done" : "aborted",
+           (micros() - t0) / 1000, (unsigned long)(planned / 1000));
+  return ok;
+}
+
+// net steps the whole recording moves each axis
+void recordingNet(int64_t &n1, int64_t &n2) {
+  n1 = n2 = 0;
+  for (uint16_t i = 0; i < segmentCount; i++) {
+    n1 += (int64_t)segments[i].dir1 * segments[i].pulses1;
+    n2 += (int64_t)segments[i].dir2 * segments[i].pulses2;
+  }
+}
+
+// remember where the recorded path starts, given where a run begins
+// a retrace ends where the path began, so it keeps the last start pose
+void markHome(bool reverse) {
+  positions.read(homePos1, homePos2);
+  if (reverse) {
+    int64_t n1, n2;
+    recordingNet(n1, n2);
+    homePos1 -= n1;
+    homePos2 -= n2;
+  } else {
+    updateOdometry();
+    homeXUm     = odom.xUm();
+    homeYUm     = odom.yUm();
+    homeHeading = odom.heading();
+  }
+}
+
+bool moveBy(int64_t d1, int64_t d2) {
+  int64_t p1, p2;
+  positions.read(p1, p2);
+  return goToPosition(p1 + d1, p2 + d2);
+}
+
+// in-place turn by a binary angle: left wheel back, right wheel forward
+bool spinBy(int32_t bam) {
+  int64_t s = odom.spinSteps(bam);
+  return moveBy(-s, s);
+}
+
+#if RETURN_VIA_ODOMETRY
+// face the path start, drive straight to it, turn back to its heading;
+// each leg is a planned high-speed move
+void returnToOrigin() {
+  updateOdometry();
+  int64_t  dx = homeXUm - odom.xUm(), dy = homeYUm - odom.yUm();
+  uint32_t dist    = isqrt64((uint64_t)(dx * dx + dy * dy));
+  int64_t  steps   = odom.driveSteps(dist);
+  uint32_t heading = odom.heading();
+  uint32_t bearing = steps ? atan2Bam(dy, dx) : heading;
+  dlog.log("> RETURN %lumm turn %ldmrad\n", (unsigned long)(dist / 1000),
+           (long)bamToMrad(bearing - heading));
+
+  if (steps && !(spinBy((int32_t)(bearing - heading)) && moveBy(steps, steps))) return;
+  spinBy((int32_t)(homeHeading - bearing));
+  updateOdometry();
+}
+#else
+// single planned high-speed move back to the start of the path
+void returnToOrigin() {
+  int64_t p1, p2;
+  positions.read(p1, p2);
+  dlog.log("> RETURN %ld,%ld\n", (long)(homePos1 - p1), (long)(homePos2 - p2));
+  goToPosition(homePos1, homePos2);
 }
+#endif
 
-void playbackSequence(bool reverse) {
+static const char *const LATENCY_NAMES[LAT_STAGES] = {
+  "input->enqueue", "enqueue->step", "input->step", "poll gap"
+};
+
+void printLatency() {
+  for (uint8_t s = 0; s < LAT_STAGES; s++) {
+    const LatencyHist &h = latency.hist(LatencyStage(s));
+    Serial.printf("%s: n=%lu", LATENCY_NAMES[s], (unsigned long)h.count);
+    if (!h.count) {
+      Serial.println();
+      continue;
+    }
+    Serial.printf(" min %luus mean %luus max %luus\n", (unsigned long)h.minUs,
+                  (unsigned long)h.meanUs(), (unsigned long)h.maxUs);
+    for (uint8_t k = 0; k < LATENCY_BUCKETS; k++) {
+      if (!h.bins[k]) continue;
+      if (k == LATENCY_BUCKETS - 1) Serial.printf("  >=%8lu us %lu\n", 1UL << (k - 1), (unsigned long)h.bins[k]);
+      else                          Serial.printf("  < %8lu us %lu\n", 1UL << k, (unsigned long)h.bins[k]);
+    }
+  }
+}
+
+// dump the captured controller trace; the I lines replay on a host with
+// program --replay
+void exportInputTrace() {
+  writeInputTrace(inputTrace, micros(),
+                  [](const char *line, void *) { Serial.println(line); }, nullptr);
+}
+
+void printCycleStats() {
+  dlog.log("Cycles %lu: mean %luus min %luus max %luus "
+           "drift %ldus worst %ldus\n",
+           (unsigned long)cycleStats.cycles,
+           (unsigned long)cycleStats.meanUs(),
+           (unsigned long)cycleStats.minUs,
+           (unsigned long)cycleStats.maxUs,
+           (long)cycleStats.driftUs,
+           (long)cycleStats.worstDriftUs);
+}
+
+// a fresh run, or the continuation of a paused one
+void playbackSequence(bool reverse, const PlaybackSnapshot *resume = nullptr) {
   if (!segmentCount) {
-    Serial.println("No recording to play");
+    dlog.log("No recording to play\n");
     return;
   }
-  playbackMode = true;
-  Serial.println(reverse ? "--- PLAY REV ---" : "--- PLAY FWD ---");
-
-  int16_t idx = reverse ? segmentCount - 1 : 0;
-  int16_t end = reverse ? -1               : segmentCount;
-  int8_t  step = reverse ? -1               : 1;
-
-  while (idx != end && playbackMode) {
-    auto &s = segments[idx];
-    // set direction & enable
-    digitalWrite(DIR1_PIN, s.dir1 > 0 ? HIGH : LOW);
-    digitalWrite(DIR2_PIN, s.dir2 > 0 ? HIGH : LOW);
-    enable1(s.dir1 != 0);
-    enable2(s.dir2 != 0);
-
-    // interleave steps evenly over duration
-    long maxP = max(s.pulses1, s.pulses2);
-    if (maxP <= 0) {
-      delay(s.durationMs);
-    } else {
-      unsigned long totalUs  = s.durationMs * 1000UL;
-      unsigned long periodUs = totalUs / maxP;
-      for (long k=0; k<maxP && playbackMode; k++) {
-        unsigned long t0 = micros();
-        if (k < s.pulses1) digitalWrite(STEP1_PIN, HIGH);
-        if (k < s.pulses2) digitalWrite(STEP2_PIN, HIGH);
-        delayMicroseconds(STEP_DELAY_US);
-        if (k < s.pulses1) digitalWrite(STEP1_PIN, LOW);
-        if (k < s.pulses2) digitalWrite(STEP2_PIN, LOW);
-
-        unsigned long elapsed = micros() - t0;
-        if (periodUs > elapsed) {
-          delayMicroseconds(periodUs - elapsed);
-        }
-
-        xbox.onLoop();  // allow abort check
-        if (xbox.xboxNotif.btnX) {
-          Serial.println("Playback aborted");
-          playbackMode = false;
-          break;
-        }
+  prepareSchedule();
+  playbackMode   = true;
+  abortRequested = false;
+  runLinkLost    = false;
+  paused.valid   = false;
+  if (resume) {
+    playMode   = resume->mode;
+    loopCycles = resume->loopCycles;
+    dlog.log("--- PLAY RESUME at #%lu +%lu ---\n", resume->at.segment,
+             (unsigned long)resume->at.steps);
+  } else {
+    dlog.log(reverse ? "--- PLAY REV ---\n" : "--- PLAY FWD ---\n");
+  }
+  if (playMode != PLAY_ONCE) {
+    dlog.log("Mode %s x%lu\n", playModeName(playMode), (unsigned long)loopCycles);
+  }
+
+  feed.reset();
+  cycleStats.reset();
+  if (!resume) markHome(reverse);
+
+  // continuous modes chain runs back to back: drivers stay enabled and
+  // the inter-segment settle gap is dropped
+  uint32_t    gapUs     = playMode == PLAY_ONCE ? params.gapUs : 0;
+  uint32_t    cycles    = resume ? resume->cycles : 0;
+  bool        secondLeg = resume && resume->secondLeg;
+  bool        partial   = resume != nullptr;   // not a full cycle: no stats
+  RunProgress at        = resume ? resume->at : RunProgress{};
+  bool        ok        = true;
+  while (true) {
+    unsigned long c0 = micros();
+    uint32_t planned = 0;
+    if (!secondLeg) {
+      ok = runSchedule(reverse, gapUs, planned, at);
+      if (ok) at = RunProgress{};
+      secondLeg = ok && playMode == PLAY_PINGPONG;
+    }
+    if (ok && secondLeg) {
+      ok = runSchedule(!reverse, gapUs, planned, at);
+      if (ok) {
+        at        = RunProgress{};
+        secondLeg = false;
       }
     }
+    if (!ok) break;
+    cycles++;
+    if (!partial) cycleStats.add(micros() - c0, planned);
+    partial = false;
 
-    delay(50);
-    idx += step;
+    if (playMode == PLAY_ONCE) break;
+    if (loopCycles && cycles >= loopCycles) break;
+    if (cycles % STATS_REPORT_CYCLES == 0) printCycleStats();
   }
 
-  enable1(false);
-  enable2(false);
+  disableAxes();
   playbackMode = false;
-  Serial.println("--- PLAY COMPLETE ---");
+  if (playMode != PLAY_ONCE) printCycleStats();
+  if (!ok && runLinkLost && !estopLatched) {
+    paused = { true, reverse, secondLeg, playMode, loopCycles, cycles, at,
+               schedule.stamp, 0, 0 };
+    positions.read(paused.pos1, paused.pos2);
+    dlog.log("Paused at #%lu +%lu steps: A resumes, X discards\n",
+             at.segment, (unsigned long)at.steps);
+  }
+  dlog.log("--- PLAY COMPLETE ---\n");
+}
+
+// continue the paused run if nothing has changed underneath it
+void resumePlayback() {
+  PlaybackSnapshot s = paused;
+  if (!scheduleValid || schedule.stamp != s.stamp) {
+    paused.valid = false;
+    dlog.log("Recording changed: paused run dropped\n");
+    return;
+  }
+  int64_t p1, p2;
+  positions.read(p1, p2);
+  if (p1 != s.pos1 || p2 != s.pos2) {
+    dlog.log("Moved since the pause: cannot resume (X discards)\n");
+    return;
+  }
+  playbackSequence(s.reverse, &s);
 }
 
 //—————————————————————————————————————————————
-// Display & Setup
+// Display
 //—————————————————————————————————————————————
 
 void updateDisplay() {
@@ -200,18 +979,763 @@ void updateDisplay() {
   M5.Lcd.setTextSize(2);
   M5.Lcd.setTextColor(WHITE, BLACK);
   M5.Lcd.setCursor(0, 0);
+  if (estopLatched) {
+    M5.Lcd.setTextColor(RED, BLACK);
+    M5.Lcd.printf("E-STOP  (BtnA clears)\n");
+    M5.Lcd.setTextColor(WHITE, BLACK);
+  }
+  if (!controllerLink.up()) M5.Lcd.printf("Hold Xbox bind to pair\n");
+  if (streamActive) M5.Lcd.printf(gcodeStream ? "HOST GCODE\n" : "HOST STREAM\n");
   M5.Lcd.printf("REC:%s  PLAY:%s\n",
     recordingMode ? "ON " : "OFF",
     playbackMode   ? "ON " : "OFF");
-  M5.Lcd.printf("Segs: %u\n", segmentCount);
+  M5.Lcd.printf("Segs: %u  Stick: %s\n", segmentCount,
+                liveStick().name);
+  if (paused.valid) {
+    M5.Lcd.printf("PAUSED #%u +%lu (A/X)\n", paused.at.segment,
+                  (unsigned long)paused.at.steps);
+  }
+  if (playMode == PLAY_ONCE) {
+    M5.Lcd.printf("Mode: ONCE\n");
+  } else if (loopCycles) {
+    M5.Lcd.printf("Mode: %s x%lu\n", playModeName(playMode),
+                  (unsigned long)loopCycles);
+  } else {
+    M5.Lcd.printf("Mode: %s forever\n", playModeName(playMode));
+  }
+  int64_t p1, p2;
+  positions.read(p1, p2);
+  M5.Lcd.printf("Pos: %lld, %lld\n", (long long)p1, (long long)p2);
+  Pose ps = odom.pose();
+  M5.Lcd.printf("x%ld y%ld %ldmrad\n", (long)ps.xMm, (long)ps.yMm,
+                (long)ps.thetaMrad);
+  if (cycleStats.cycles > 1) {
+    M5.Lcd.printf("Cyc %lu  %lums\n", (unsigned long)cycleStats.cycles,
+                  (unsigned long)(cycleStats.meanUs() / 1000));
+  }
+}
+
+// TASK_DISPLAY: the periodic refresh, held off while the banner is up
+void refreshDisplay() {
+  if (!bannerUp) updateDisplay();
+}
+
+// TASK_BANNER: CONNECTED! has been up for BANNER_US
+void endBanner() {
+  bannerUp = false;
+  updateDisplay();
+}
+
+// report a latched e-stop once; BtnA clears it after BtnC is released.
+// ENA is forced HIGH again on every pass, so no write that raced the ISR
+// can leave a driver on
+void serviceEStop() {
+  if (!estopLatched) return;
+  GPIO.out_w1ts = ESTOP_ENABLE_MASK;
+  enState = 0;
+  if (!estopReported) {
+    estopReported = true;
+    unsigned long ns = estopCycles * 1000UL / (F_CPU / 1000000UL);
+    if (estopSeenUs) {
+      dlog.log("!! E-STOP: drivers off %lu cycles (%lu ns) after ISR entry, "
+               "motion loop stopped %luus later\n", (unsigned long)estopCycles, ns,
+               (unsigned long)(estopSeenUs - estopAtUs));
+    } else {
+      dlog.log("!! E-STOP: drivers off %lu cycles (%lu ns) after ISR entry\n",
+               (unsigned long)estopCycles, ns);
+    }
+    updateDisplay();
+  }
+  if (digitalRead(ESTOP_CLEAR_PIN) == LOW && digitalRead(ESTOP_PIN) == HIGH) {
+    estopLatched  = false;
+    estopReported = false;
+    estopSeenUs   = 0;
+    enState       = 0xFF;                // pins were forced; rewrite on next use
+    disableAxes();
+    dlog.log("> E-STOP CLEARED\n");
+    updateDisplay();
+  }
+}
+
+//—————————————————————————————————————————————
+// Button Handlers
+//—————————————————————————————————————————————
+
+// LB → toggle recording
+void onRecordButton(const InputEvent &) {
+  if (playbackMode) return;
+  if (!recordingMode) {
+    dlog.log("> RECORD START\n");
+    clearCounts();
+    segmentCount = 0;
+    scheduleValid = false;
+    recordingMode = true;
+    markHome(false);
+    startSegment(0, 0);
+  } else {
+    dlog.log("> RECORD CANCEL\n");
+    recordingMode = false;
+  }
+}
+
+// RB → record current segment
+void onSegmentButton(const InputEvent &) {
+  if (recordingMode) recordSegment(lastDir1, lastDir2);
+}
+
+// Back → save, Start → load
+void onSaveButton(const InputEvent &) {
+  if (!recordingMode && !playbackMode) saveToFlash();
+}
+
+void onLoadButton(const InputEvent &) {
+  if (recordingMode || playbackMode) return;
+  loadFromFlash();
+  updateDisplay();
+}
+
+// A → play forward, B → retrace
+// A with a run paused by a controller drop resumes it
+void onPlayButton(const InputEvent &e) {
+  if (recordingMode || playbackMode) return;
+  latency.input(e.tUs);
+  if (e.button == BTN_A && paused.valid) resumePlayback();
+  else                                   playbackSequence(e.button == BTN_B);
+  updateDisplay();
+}
+
+// X → abort a run in progress (the motion loop ramps down and returns),
+// or discard a paused one
+void onAbortButton(const InputEvent &) {
+  if (!playbackMode && paused.valid) {
+    paused.valid = false;
+    dlog.log("> PAUSED RUN DISCARDED\n");
+    updateDisplay();
+    return;
+  }
+  if (!playbackMode || abortRequested) return;
+  dlog.log("> PLAY ABORT\n");
+  abortRequested = true;
+}
+
+// Y → delete saved segments (when idle)
+void onDeleteButton(const InputEvent &) {
+  if (recordingMode || playbackMode) return;
+  deleteSegmentsFromFlash();
+  updateDisplay();
+}
+
+// D-pad Up → once / loop / ping-pong, Right → loop count
+void onPlayModeButton(const InputEvent &) {
+  if (playbackMode) return;
+  playMode = PlayMode((playMode + 1) % 3);
+  updateDisplay();
+}
+
+void onLoopCountButton(const InputEvent &) {
+  if (playbackMode) return;
+  loopPreset = (loopPreset + 1) % (sizeof(LOOP_PRESETS) / sizeof(LOOP_PRESETS[0]));
+  loopCycles = LOOP_PRESETS[loopPreset];
+  updateDisplay();
+}
+
+// D-pad Left → current position becomes the origin
+void onOriginButton(const InputEvent &) {
+  if (playbackMode) return;
+  int64_t p1, p2;
+  positions.read(p1, p2);
+  homePos1 -= p1;
+  homePos2 -= p2;
+  // re-express the start pose in the frame of the new origin
+  updateOdometry();
+  int64_t  dx = homeXUm - odom.xUm(), dy = homeYUm - odom.yUm();
+  uint32_t th = odom.heading();
+  homeXUm = ( dx * cosQ15(th) + dy * sinQ15(th)) >> 15;
+  homeYUm = (-dx * sinQ15(th) + dy * cosQ15(th)) >> 15;
+  homeHeading -= th;
+  positions.setOrigin();
+  odom.reset(0, 0);
+  dlog.log("> ORIGIN SET\n");
+  updateDisplay();
+}
+
+// D-pad Down → rapid return to the start of the recorded path
+void onReturnButton(const InputEvent &e) {
+  if (recordingMode || playbackMode) return;
+  latency.input(e.tUs);
+  returnToOrigin();
+  updateDisplay();
+}
+
+// LS click → next stick response profile, remembered in flash (when
+// idle, so the NVS write never stalls a run or a recording)
+void onStickProfileButton(const InputEvent &) {
+  if (recordingMode || playbackMode) return;
+  stickProfile = (stickProfile + 1) % (STICK_PROFILE_COUNT + 1);
+  saveSettings();
+  dlog.log("> STICK %s\n", liveStick().name);
+  updateDisplay();
+}
+
+static const InputBinding BUTTON_MAP[] = {
+  { BTN_LB,    onRecordButton,    nullptr },
+  { BTN_RB,    onSegmentButton,   nullptr },
+  { BTN_BACK,  onSaveButton,      nullptr },
+  { BTN_START, onLoadButton,      nullptr },
+  { BTN_A,     onPlayButton,      nullptr },
+  { BTN_B,     onPlayButton,      nullptr },
+  { BTN_X,     onAbortButton,     nullptr },
+  { BTN_Y,     onDeleteButton,    nullptr },
+  { BTN_UP,    onPlayModeButton,  nullptr },
+  { BTN_RIGHT, onLoopCountButton, nullptr },
+  { BTN_LEFT,  onOriginButton,    nullptr },
+  { BTN_DOWN,  onReturnButton,    nullptr },
+  { BTN_LS,    onStickProfileButton, nullptr },
+};
+
+//—————————————————————————————————————————————
+// Host Commands
+//—————————————————————————————————————————————
+
+// Serial hot keys, acted on at the start of a line: L = latency
+// histograms, Z = clear them; T = export the input trace, R = replay
+// it, C = restart capture; M = next telemetry rate
+static const char HOT_KEYS[] = "LZTRCM";
+
+void textCommand(char c) {
+  if (c == 'L') printLatency();
+  if (c == 'Z') latency.reset();
+  if (c == 'T') exportInputTrace();
+  if (c == 'R' && inputTrace.startReplay(micros())) {
+    dlog.log("Replaying %lu input samples\n", (unsigned long)inputTrace.count());
+  }
+  if (c == 'C') inputTrace.begin(micros());
+  if (c == 'M') {
+    telemetryPreset = (telemetryPreset + 1) % (sizeof(TELEMETRY_RATES) / sizeof(TELEMETRY_RATES[0]));
+    telemetry.setRate(TELEMETRY_RATES[telemetryPreset]);
+    dlog.log("> TELEMETRY %lu Hz\n", (unsigned long)TELEMETRY_RATES[telemetryPreset]);
+  }
+}
+
+// the live stream, whichever kind is running (or ran last)
+uint8_t  streamQueued()    { return gcodeStream ? moveQueue.size()  : streamQueue.size(); }
+uint8_t  streamSpace()     { return gcodeStream ? moveQueue.space() : streamQueue.space(); }
+uint32_t streamCompleted() { return gcodeStream ? moves.completed() : stream.completed(); }
+uint32_t streamUnderruns() { return gcodeStream ? moves.underruns() : stream.underruns(); }
+
+void sendStreamEvent(StreamState state) {
+  uint8_t p[10];
+  WireOut out(p, sizeof(p));
+  out.u8(streamSpace());
+  out.u32(streamCompleted());
+  out.u32(streamUnderruns());
+  out.u8(state);
+  sendFrame(EVT_STREAM, p, out.len());
+  streamReported = streamCompleted();
+}
+
+// run host segments or G-code moves as they arrive until the host ends
+// the stream and the queue drains, or X / STOP / a controller drop winds
+// it down. No settle gap between segments; an empty queue holds the
+// drivers enabled. G-code starts from the current axis positions in G90,
+// and M17 holds the drivers only until the stream ends.
+void runStream() {
+  if (gcodeStream) {
+    int64_t p1, p2;
+    positions.read(p1, p2);
+    gcodeParser.reset();
+    gcode.setMaxRate(params.safeRate);
+    gcode.begin(p1, p2);
+    moveQueue.reset();
+    moves.begin(moveQueue, params.accel, INPUT_POLL_US);
+  } else {
+    streamQueue.reset();
+    stream.begin(streamQueue, INPUT_POLL_US);
+  }
+  streamReported = 0;
+  streamActive   = true;
+  playbackMode   = true;
+  abortRequested = false;
+  runLinkLost    = false;
+  feed.reset();
+  dlog.log(gcodeStream ? "--- GCODE ---\n" : "--- STREAM ---\n");
+  updateDisplay();
+
+  uint32_t planned = 0;
+  bool     ok      = gcodeStream ? runTicks(moves, true, planned)
+                                 : runTicks(stream, true, planned);
+
+  disableAxes();
+  playbackMode = false;
+  streamActive = false;
+  sendStreamEvent(ok ? STREAM_DONE : STREAM_ABORTED);
+  dlog.log("--- STREAM %s: %lu %s, %lu underruns ---\n",
+           ok ? "COMPLETE" : "ABORTED", (unsigned long)streamCompleted(),
+           gcodeStream ? "moves" : "segments", (unsigned long)streamUnderruns());
 }
 
+uint8_t cmdPing(WireIn &, WireOut &out) {
+  out.u8(PROTOCOL_VERSION);
+  out.u16(MAX_SEGMENTS);
+  out.u8(SEGMENT_QUEUE_LEN);
+  out.u8(COMMAND_SEGMENTS_MAX);
+  out.u8(MOVE_QUEUE_LEN);
+  return ST_OK;
+}
+
+uint8_t cmdStatus(WireIn &, WireOut &out) {
+  int64_t p1, p2;
+  positions.read(p1, p2);
+  out.u16(motionFlags());
+  out.u32((uint32_t)(int32_t)p1);
+  out.u32((uint32_t)(int32_t)p2);
+  out.u16(segmentCount);
+  out.u8(streamQueued());
+  out.u8(streamSpace());
+  out.u32(streamCompleted());
+  out.u32(streamUnderruns());
+  return ST_OK;
+}
+
+// the recording in RAM and the one saved in flash, by count and stamp
+uint8_t cmdList(WireIn &, WireOut &out) {
+  static Segment stored[MAX_SEGMENTS];
+  out.u16(segmentCount);
+  out.u32(segmentsStamp(segments, segmentCount));
+  preferences.begin("robocan", true);
+  uint16_t n = preferences.getUShort("count", 0);
+  if (n > MAX_SEGMENTS) n = 0;
+  if (n) preferences.getBytes("data", stored, sizeof(Segment) * n);
+  preferences.end();
+  out.u16(n);
+  out.u32(segmentsStamp(stored, n));
+  return ST_OK;
+}
+
+// chunks must arrive in order from offset 0, which starts a new
+// recording; it replaces segments[] once the last chunk is in
+uint8_t cmdUpload(WireIn &in, WireOut &out) {
+  uint8_t  save   = in.u8();
+  uint16_t total  = in.u16();
+  uint16_t offset = in.u16();
+  uint8_t  n      = in.u8();
+  if (!in.ok() || n > COMMAND_SEGMENTS_MAX || in.left() != n * SEGMENT_WIRE_BYTES) return ST_BAD;
+  if (total > MAX_SEGMENTS || offset + n > total) return ST_RANGE;
+  if (!offset) {
+    uploadTotal   = total;
+    uploadNext    = 0;
+    segmentCount  = 0;
+    scheduleValid = false;
+  }
+  if (total != uploadTotal || offset != uploadNext) return ST_RANGE;
+  for (uint8_t i = 0; i < n; i++) segments[offset + i] = in.segment();
+  uploadNext += n;
+  out.u16(uploadNext);
+  if (uploadNext == uploadTotal) {
+    segmentCount = uploadTotal;
+    dlog.log("Received %lu segments\n", (unsigned long)segmentCount);
+    if (save & 1) saveToFlash();
+    updateDisplay();
+  }
+  return ST_OK;
+}
+
+uint8_t cmdDownload(WireIn &in, WireOut &out) {
+  uint16_t offset = in.u16();
+  uint8_t  n      = in.u8();
+  if (!in.ok()) return ST_BAD;
+  if (offset > segmentCount) return ST_RANGE;
+  if (n > COMMAND_SEGMENTS_MAX) n = COMMAND_SEGMENTS_MAX;
+  if (n > segmentCount - offset) n = segmentCount - offset;
+  out.u16(segmentCount);
+  out.u16(offset);
+  out.u8(n);
+  for (uint8_t i = 0; i < n; i++) out.segment(segments[offset + i]);
+  return ST_OK;
+}
+
+uint8_t cmdDelete(WireIn &, WireOut &) {
+  deleteSegmentsFromFlash();
+  updateDisplay();
+  return ST_OK;
+}
+
+uint8_t cmdPlay(WireIn &in, WireOut &) {
+  hostReverse = in.u8() & 1;
+  if (!in.ok()) return ST_BAD;
+  if (estopLatched) return ST_BUSY;
+  return segmentCount ? ST_OK : ST_STATE;
+}
+
+void startHostPlay() {
+  playbackSequence(hostReverse);
+  updateDisplay();
+}
+
+uint8_t cmdStop(WireIn &, WireOut &) {
+  if (!playbackMode) return ST_STATE;
+  if (!abortRequested) {
+    dlog.log("> HOST STOP\n");
+    abortRequested = true;
+  }
+  return ST_OK;
+}
+
+uint8_t cmdStreamBegin(WireIn &in, WireOut &out) {
+  uint8_t mode = in.left() ? in.u8() : 0;
+  if (mode > 1) return ST_BAD;
+  if (estopLatched) return ST_BUSY;
+  gcodeStream = mode == 1;
+  out.u8(gcodeStream ? MOVE_QUEUE_LEN : SEGMENT_QUEUE_LEN);
+  return ST_OK;
+}
+
+// all or nothing: a push larger than the free slots is refused whole
+uint8_t cmdStreamPush(WireIn &in, WireOut &out) {
+  uint8_t n = in.u8();
+  if (!in.ok() || n > COMMAND_SEGMENTS_MAX || in.left() != n * SEGMENT_WIRE_BYTES) return ST_BAD;
+  if (!streamActive || gcodeStream || streamQueue.ended()) return ST_STATE;
+  if (n > streamQueue.space()) {
+    out.u8(streamQueue.space());
+    return ST_FULL;
+  }
+  for (uint8_t i = 0; i < n; i++) streamQueue.push(in.segment());
+  out.u8(streamQueue.space());
+  return ST_OK;
+}
+
+// G-code text: each line ending in the frame yields at most one move, so
+// a frame ending more lines than there are free slots is refused whole.
+// Bad lines are skipped and the first is reported; the host decides
+// whether to stop.
+uint8_t cmdGcode(WireIn &in, WireOut &out) {
+  if (!streamActive || !gcodeStream || moveQueue.ended()) return ST_STATE;
+  WireIn  scan  = in;
+  uint8_t lines = 0;
+  while (scan.left()) {
+    if (scan.u8() == '\n') lines++;
+  }
+  if (lines > moveQueue.space()) {
+    out.u8(moveQueue.space());
+    return ST_FULL;
+  }
+
+  uint8_t  error     = GC_OK;
+  uint32_t errorLine = 0;
+  while (in.left()) {
+    if (!gcodeParser.feed((char)in.u8())) continue;
+    PlannerMove m;
+    GcodeError  e = gcode.apply(gcodeParser.line(), m);
+    if (e && !error) {
+      error     = e;
+      errorLine = gcodeParser.line().number;
+      dlog.log("G-code line %lu: error %ld\n", (unsigned long)errorLine, (long)e);
+    }
+    if (!e && m.kind != PLAN_NONE) moveQueue.push(m);
+  }
+  out.u8(moveQueue.space());
+  out.u8(error);
+  out.u32(errorLine);
+  return ST_OK;
+}
+
+uint8_t cmdStreamEnd(WireIn &, WireOut &out) {
+  if (!streamActive) return ST_STATE;
+  if (gcodeStream) moveQueue.end();
+  else             streamQueue.end();
+  out.u8(streamSpace());
+  return ST_OK;
+}
+
+// idle: refused with ST_BUSY while recording or anything is moving;
+// then: runs after the reply is sent (the long-running part)
+struct CommandBinding {
+  uint8_t type;
+  uint8_t (*handler)(WireIn &in, WireOut &out);
+  bool    idle;
+  void  (*then)();
+};
+
+static const CommandBinding COMMAND_MAP[] = {
+  { CMD_PING,         cmdPing,        false, nullptr },
+  { CMD_STATUS,       cmdStatus,      false, nullptr },
+  { CMD_LIST,         cmdList,        true,  nullptr },
+  { CMD_UPLOAD,       cmdUpload,      true,  nullptr },
+  { CMD_DOWNLOAD,     cmdDownload,    false, nullptr },
+  { CMD_DELETE,       cmdDelete,      true,  nullptr },
+  { CMD_PLAY,         cmdPlay,        true,  startHostPlay },
+  { CMD_STOP,         cmdStop,        false, nullptr },
+  { CMD_STREAM_BEGIN, cmdStreamBegin, true,  runStream },
+  { CMD_STREAM_PUSH,  cmdStreamPush,  false, nullptr },
+  { CMD_STREAM_END,   cmdStreamEnd,   false, nullptr },
+  { CMD_GCODE,        cmdGcode,       false, nullptr },
+};
+
+// reply: seq, status, then whatever the handler wrote
+void dispatchCommand(bool inMotion) {
+  WireIn  in(hostRx.payload(), hostRx.len());
+  uint8_t reply[COMMAND_PAYLOAD_MAX];
+  WireOut out(reply, sizeof(reply));
+  uint8_t seq = in.u8();
+  out.u8(seq);
+  out.u8(ST_UNKNOWN);
+
+  const CommandBinding *cmd = nullptr;
+  for (const CommandBinding &c : COMMAND_MAP) {
+    if (c.type == hostRx.type()) cmd = &c;
+  }
+  uint8_t status = ST_UNKNOWN;
+  if (!in.ok())      status = ST_BAD;
+  else if (cmd)      status = cmd->idle && (inMotion || playbackMode || recordingMode)
+                                ? (uint8_t)ST_BUSY : cmd->handler(in, out);
+  reply[1] = status;
+  sendFrame(hostRx.type() | CMD_REPLY, reply, out.len());
+  if (status == ST_OK && cmd->then) cmd->then();
+}
+
+// Serial shell: a line of words per command. Reading and staging work
+// mid-run too; anything that starts motion or writes flash waits for
+// idle. Replies go through the deferred log, so nothing here waits.
+
+uint16_t listNext = 0, listEnd = 0;   // segs lines still to print
+
+const ParamBinding *findParam(const char *name) {
+  for (const ParamBinding &b : PARAM_MAP) {
+    if (!strcmp(name, b.name)) return &b;
+  }
+  return nullptr;
+}
+
+void shellHelp();
+
+// get [name]: value, unit and range; "pending" until adopted
+void shellGet() {
+  bool any = false;
+  for (const ParamBinding &b : PARAM_MAP) {
+    if (shell.argc() > 1 && strcmp(shell.arg(1), b.name)) continue;
+    bool staged = paramsPending && pendingParams.*b.field != params.*b.field;
+    dlog.log("%s = %lu %s (%lu..%lu)%s\n", b.name, (unsigned long)(params.*b.field),
+             b.unit, (unsigned long)b.min, (unsigned long)b.max, staged ? " pending" : "");
+    any = true;
+  }
+  if (!any) dlog.log("? get: no such parameter\n");
+}
+
+// set name value [name value ...]: checked as a whole against the staged
+// set, then handed to the motion loop to adopt between steps
+void shellSet() {
+  if (shell.argc() < 3 || !(shell.argc() & 1)) {
+    dlog.log("? set name value [name value ...]\n");
+    return;
+  }
+  MotionParams p     = paramsPending ? pendingParams : params;
+  bool         stick = false;
+  for (uint8_t i = 1; i + 1 < shell.argc(); i += 2) {
+    const ParamBinding *b = findParam(shell.arg(i));
+    uint32_t v;
+    if (!b) {
+      dlog.log("? set: no such parameter\n");
+      return;
+    }
+    if (!parseU32(shell.arg(i + 1), v)) {
+      dlog.log("? set %s: not a number\n", b->name);
+      return;
+    }
+    p.*b->field = v;
+    stick |= b->field == &MotionParams::deadPct || b->field == &MotionParams::expoPct;
+  }
+  const char *bad = paramsProblem(p);
+  if (bad) {
+    dlog.log("? set: %s out of range\n", bad);
+    return;
+  }
+  pendingParams = p;
+  paramsPending = true;
+  if (stick) {                          // shaping the stick means using it
+    stickProfile = STICK_PROFILE_COUNT;
+    displayDirty = true;                // may be mid-run: no LCD work here
+  }
+  dlog.log("> SET staged\n");
+}
+
+void shellDefaults() {
+  pendingParams = DEFAULT_PARAMS;
+  paramsPending = true;
+  dlog.log("> DEFAULTS staged\n");
+}
+
+void shellSave() {
+  if (paramsPending) adoptParams();
+  saveParams();
+  saveSettings();
+}
+
+// stats [reset]: latency/jitter summaries, playback cycles, log and
+// stream health; L prints the full histograms
+void shellStats() {
+  if (!strcmp(shell.arg(1), "reset")) {
+    latency.reset();
+    sched.resetStats();
+    dlog.log("> STATS RESET\n");
+    return;
+  }
+  for (uint8_t s = 0; s < LAT_STAGES; s++) {
+    const LatencyHist &h = latency.hist(LatencyStage(s));
+    dlog.log("%s: n=%lu min %luus mean %luus max %luus\n", LATENCY_NAMES[s],
+             (unsigned long)h.count, (unsigned long)(h.count ? h.minUs : 0),
+             (unsigned long)h.meanUs(), (unsigned long)h.maxUs);
+  }
+  if (cycleStats.cycles) printCycleStats();
+  dlog.log("Log: %lu records, %lu dropped, high water %lu\n",
+           (unsigned long)dlog.logged(), (unsigned long)dlog.dropped(),
+           (unsigned long)dlog.highWater());
+  dlog.log("Stream: %lu done, %lu underruns; %lu bad frames\n",
+           (unsigned long)streamCompleted(), (unsigned long)streamUnderruns(),
+           (unsigned long)hostRx.errors());
+  for (uint8_t i = 0; i < sched.count(); i++) {
+    const TaskStats &ts = sched.stats(i);
+    dlog.log("Task %s: %lu runs, %lu late, worst %luus mean %luus\n",
+             sched.spec(i).name, (unsigned long)ts.runs, (unsigned long)ts.late,
+             (unsigned long)ts.worstUs,
+             (unsigned long)(ts.runs ? ts.totalUs / ts.runs : 0));
+  }
+}
+
+// segs [from]: printed a few lines per pass by continueListing()
+void shellSegs() {
+  uint32_t from = 0;
+  if (shell.argc() > 1 && !parseU32(shell.arg(1), from)) {
+    dlog.log("? segs [from]\n");
+    return;
+  }
+  listNext = from < segmentCount ? (uint16_t)from : segmentCount;
+  listEnd  = segmentCount;
+  dlog.log("Segments %lu (limit %lu)\n", (unsigned long)segmentCount,
+           (unsigned long)params.segLimit);
+}
+
+void continueListing() {
+  if (listEnd > segmentCount) listEnd = segmentCount;   // deleted meanwhile
+  for (uint8_t i = 0; i < 8 && listNext < listEnd && dlog.room() > LOG_RECORDS / 2; i++) {
+    const Segment &g = segments[listNext++];
+    dlog.log("#%lu d1=%ld p1=%ld d2=%ld p2=%ld t=%lums\n", (unsigned long)listNext,
+             (long)g.dir1, (long)g.pulses1, (long)g.dir2, (long)g.pulses2,
+             (unsigned long)g.durationMs);
+  }
+}
+
+// play [rev]
+void shellPlay() {
+  if (estopLatched || !segmentCount) {
+    dlog.log("? play: %s\n", estopLatched ? "e-stop latched" : "nothing recorded");
+    return;
+  }
+  hostReverse = !strcmp(shell.arg(1), "rev");
+  startHostPlay();
+}
+
+void shellStop() {
+  if (playbackMode && !abortRequested) {
+    dlog.log("> SHELL STOP\n");
+    abortRequested = true;
+  }
+}
+
+struct ShellBinding {
+  const char *name;
+  void      (*handler)();
+  bool        idle;                     // refused while recording or moving
+  const char *help;
+};
+
+static const ShellBinding SHELL_MAP[] = {
+  { "help",     shellHelp,     false, "this list" },
+  { "get",      shellGet,      false, "get [name]: motion parameters" },
+  { "set",      shellSet,      false, "set name value ...: applied between steps" },
+  { "defaults", shellDefaults, false, "back to the built-in parameters" },
+  { "save",     shellSave,     true,  "keep the parameters in flash" },
+  { "stats",    shellStats,    false, "stats [reset]: latency, jitter, log, stream" },
+  { "segs",     shellSegs,     false, "segs [from]: list the recording" },
+  { "play",     shellPlay,     true,  "play [rev]" },
+  { "stop",     shellStop,     false, "wind down the run" },
+};
+
+void shellHelp() {
+  for (const ShellBinding &c : SHELL_MAP) dlog.log("  %s - %s\n", c.name, c.help);
+  dlog.log("  keys L Z T R C M at a line start\n");
+}
+
+void runShellLine(bool inMotion) {
+  if (shell.overflow()) {
+    dlog.log("? line too long\n");
+    return;
+  }
+  for (const ShellBinding &c : SHELL_MAP) {
+    if (strcmp(shell.arg(0), c.name)) continue;
+    if (c.idle && (inMotion || playbackMode || recordingMode)) dlog.log("? %s: busy\n", c.name);
+    else                                                       c.handler();
+    return;
+  }
+  dlog.log("? unknown command, try help\n");
+}
+
+// Serial input: frames are handled as they complete, mid-run included,
+// and so are shell lines; hot keys typed during a run wait for it to end
+void serviceHost(bool inMotion) {
+  static char    held[16];
+  static uint8_t heldCount = 0;
+  if (!inMotion) {
+    for (uint8_t i = 0; i < heldCount; i++) textCommand(held[i]);
+    heldCount = 0;
+  }
+  while (Serial.available()) {
+    uint8_t b = (uint8_t)Serial.read();
+    RxResult r = hostRx.feed(b);
+    if (r == RX_FRAME) {
+      dispatchCommand(inMotion);
+    } else if (r == RX_TEXT) {
+      char c = (char)b;
+      if (shell.empty() && strchr(HOT_KEYS, c)) {
+        if (!inMotion)                     textCommand(c);
+        else if (heldCount < sizeof(held)) held[heldCount++] = c;
+      } else if (shell.feed(c)) {
+        runShellLine(inMotion);
+      }
+    }
+  }
+  continueListing();
+  if (streamActive && streamCompleted() != streamReported) sendStreamEvent(STREAM_RUNNING);
+}
+
+//—————————————————————————————————————————————
+// Setup & Main Loop
+//—————————————————————————————————————————————
+
+static const TaskSpec TASK_MAP[] = {
+  // name        fn                period              budget  critical
+  { "input",     pollDuringMotion, INPUT_POLL_US,      300,    true  },
+  { "display",   refreshDisplay,   DISPLAY_REFRESH_US, 30000,  false },
+  { "banner",    endBanner,        0,                  30000,  false },
+#ifndef ESP_PLATFORM
+  { "background", serviceBackground, 1000,             100,    false },
+#endif
+};
+static_assert(sizeof(TASK_MAP) / sizeof(TASK_MAP[0]) == TASK_COUNT,
+              "TASK_MAP must follow TaskId");
+
 void setup() {
   M5.begin();
   M5.Lcd.setBrightness(128);
   M5.Lcd.fillScreen(BLACK);
-  Serial.begin(115200);
-  delay(200);
+  Serial.begin(SERIAL_BAUD);
+  sched.begin(TASK_MAP, TASK_COUNT);
+#ifdef ESP_PLATFORM
+  xTaskCreatePinnedToCore(logDrainTask, "log", 4096, nullptr, 1, nullptr, 0);
+  xTaskCreatePinnedToCore(telemetryTask, "tlm", 3072, nullptr, 1, nullptr, 0);
+#else
+  sched.start(TASK_BACKGROUND);
+#endif
+  yieldUntil(micros() + BOOT_SETTLE_US);
 
   pinMode(ENABLE1_PIN, OUTPUT);
   pinMode(DIR1_PIN,    OUTPUT);
@@ -219,12 +1743,15 @@ void setup() {
   pinMode(ENABLE2_PIN, OUTPUT);
   pinMode(DIR2_PIN,    OUTPUT);
   pinMode(STEP2_PIN,   OUTPUT);
-  digitalWrite(DIR1_PIN, HIGH);
-  digitalWrite(DIR2_PIN, HIGH);
-  enable1(false);
-  enable2(false);
+  setAxes(AXIS_ALL, 0);
+
+  pinMode(ESTOP_PIN,       INPUT);       // external pull-ups on the M5 Basic
+  pinMode(ESTOP_CLEAR_PIN, INPUT);
+  attachInterrupt(digitalPinToInterrupt(ESTOP_PIN), onEStop, FALLING);
 
   xbox.begin();
+  input.bind(BUTTON_MAP, sizeof(BUTTON_MAP) / sizeof(BUTTON_MAP[0]));
+  loadSettings();
   loadFromFlash();
 
   M5.Lcd.setTextSize(2);
@@ -232,124 +1759,64 @@ void setup() {
   M5.Lcd.setCursor(0, 0);
   M5.Lcd.println("Hold Xbox bind");
   M5.Lcd.println("button to pair");
+  sched.start(TASK_DISPLAY, DISPLAY_REFRESH_US);
 }
 
 void loop() {
-  xbox.onLoop();
-  if (!xbox.isConnected()) return;
+  readInput();                          // button handlers run from here
+  serviceEStop();
 
-  static bool shown = false;
-  if (!shown) {
+  serviceHost(false);                   // text commands and host frames
+  if (paramsPending) adoptParams();     // between live-drive steps
+
+  if (bannerDue && !playbackMode) {
+    bannerDue = false;
     M5.Lcd.fillScreen(BLACK);
     M5.Lcd.setTextSize(3);
     M5.Lcd.setTextColor(GREEN, BLACK);
     M5.Lcd.setCursor(0, 0);
     M5.Lcd.println("CONNECTED!");
-    delay(800);
-    shown = true;
-    updateDisplay();
+    bannerUp = true;                    // live drive carries on meanwhile
+    sched.start(TASK_BANNER, BANNER_US);
   }
-
-  // read buttons
-  bool curLB    = xbox.xboxNotif.btnLB;     // record start/cancel
-  bool curRB    = xbox.xboxNotif.btnRB;     // record segment
-  bool curA     = xbox.xboxNotif.btnA;      // play forward
-  bool curB     = xbox.xboxNotif.btnB;      // play reverse
-  bool curX     = xbox.xboxNotif.btnX;      // abort playback
-  bool curY     = xbox.xboxNotif.btnY;      // delete segments
-  bool curBack  = xbox.xboxNotif.btnSelect; // save
-  bool curStart = xbox.xboxNotif.btnStart;  // load
-
-  // 1) LB → toggle recording
-  if (curLB && !lastLB) {
-    if (!recordingMode) {
-      Serial.println("> RECORD START");
-      clearCounts();
-      segmentCount = 0;
-      recordingMode = true;
-      startSegment(0, 0);
-    } else {
-      Serial.println("> RECORD CANCEL");
-      recordingMode = false;
-    }
+  if (displayDirty) {
+    displayDirty = false;
+    refreshDisplay();                   // the banner redraws when it ends
   }
 
-  // 2) RB → record current segment
-  if (curRB && !lastRB && recordingMode) {
-    recordSegment(lastDir1, lastDir2);
-  }
-
-  // 3) Save / Load
-  if (curBack  && !lastBack  && !recordingMode && !playbackMode) saveToFlash();
-  if (curStart && !lastStart && !recordingMode && !playbackMode) {
-    loadFromFlash();
-    updateDisplay();
-  }
-
-  // 4) Playback A/B
-  if (curA && !lastA && !recordingMode && !playbackMode) {
-    playbackSequence(false);
-    updateDisplay();
-  }
-  if (curB && !lastB && !recordingMode && !playbackMode) {
-    playbackSequence(true);
-    updateDisplay();
-  }
-
-  // 5) Abort X
-  if (curX && !lastX && playbackMode) {
-    Serial.println("> PLAY ABORT");
-    playbackMode = false;
-    enable1(false);
-    enable2(false);
-    updateDisplay();
-  }
-
-  // 6) Delete saved segments → Y (when idle)
-  if (curY && !lastY && !recordingMode && !playbackMode) {
-    deleteSegmentsFromFlash();
-    updateDisplay();
-  }
-
-  // LIVE DRIVE whenever not in playback
-  if (!playbackMode) {
-    float vy = float(xbox.xboxNotif.joyLVert) /
-               XboxControllerNotificationParser::maxJoy;
-    float vx = float(xbox.xboxNotif.joyRHori) /
-               XboxControllerNotificationParser::maxJoy;
-    int8_t d1 = 0, d2 = 0;
-    if      (vy > 0.6) d1=d2=+1;
-    else if (vy < 0.4) d1=d2=-1;
-    if      (vx > 0.6) d1=0;
-    else if (vx < 0.4) d2=0;
-
-    // record on direction change
-    if (recordingMode && (d1!=lastDir1 || d2!=lastDir2)) {
-      recordSegment(lastDir1, lastDir2);
-      startSegment(d1, d2);
+  // LIVE DRIVE whenever not in playback: left stick Y = speed, right
+  // stick X = turn rate, same steering sense as before (right slows motor 1).
+  // Without a controller the last command winds down to a stop.
+  if (!playbackMode && !estopLatched) {
+    unsigned long now = micros();
+    static unsigned long lastLiveUs = now;
+    static bool liveMoving = false;
+    WheelRates r;
+    if (controllerLink.up()) {
+      const InputFrame   &f  = input.frame();
+      const StickProfile &sp = liveStick();
+      Twist cmd = { sp.v(f.joyLVert), sp.w(f.joyRHori) };
+      r = drive.toWheels(cmd);
+      // trace starts from rest: stick frame → rates set → first step
+      bool moving = r.left || r.right;
+      if (moving && !liveMoving) {
+        latency.input(f.tUs);
+        latency.enqueue(now);
+      } else if (!moving) {
+        latency.cancel();
+      }
+      liveMoving = moving;
+    } else {
+      r = windDown(liveRates, now - lastLiveUs);
+      latency.cancel();
+      liveMoving = false;
     }
-    lastDir1=d1; lastDir2=d2;
-
-    digitalWrite(DIR1_PIN, d1>0?HIGH:LOW);
-    digitalWrite(DIR2_PIN, d2>0?HIGH:LOW);
-    enable1(d1!=0);
-    enable2(d2!=0);
-    if (d1) doStep1();
-    if (d2) doStep2();
-  }
-
-  // save button edges
-  lastLB    = curLB;    lastRB    = curRB;
-  lastA     = curA;     lastB     = curB;
-  lastX     = curX;     lastY     = curY;
-  lastBack  = curBack;  lastStart = curStart;
-
-  // refresh display occasionally
-  static unsigned long t0 = 0;
-  if (millis() - t0 > 200) {
-    updateDisplay();
-    t0 = millis();
+    lastLiveUs = now;
+    driveLive(r);
   }
 
-  delay(5);
+  // between passes nothing has a deadline: a due task runs whatever its
+  // budget, so the LCD tasks, longer than the rest below, get their turn
+  sched.runNext(UINT32_MAX);
+  yieldUntil(micros() + LOOP_IDLE_US);  // tasks that fit run here
 }
@@ -0,0 +1,144 @@
+// src/move_planner.cpp
+
+#include "move_planner.h"
+
+uint32_t RampPeriod::at(uint32_t n) {
+  bool step = n >= RAMP_EXACT_TICKS && n % RAMP_RESEED_TICKS && n_ != UINT32_MAX;
+  if (n == n_) {
+    // a triangular move turns around on the same position
+  } else if (step && n == n_ + 1) {
+    uint32_t d = 4 * n + 1;
+    q8_ -= (2 * q8_ + d / 2) / d;
+  } else if (step && n + 1 == n_) {
+    uint32_t d = 4 * n + 3;
+    q8_ += (2 * q8_ + d / 2) / d;
+  } else {
+    uint32_t rate = (uint32_t)sqrtQ16(accel_ * (2 * n + 1)).raw;
+    q8_ = (uint32_t)((1000000ULL << 24) / (rate ? rate : 1));
+  }
+  n_ = n;
+  return (q8_ + 128) >> 8;
+}
+
+bool LinearMove::begin(int64_t d1, int64_t d2, uint32_t maxRate, uint32_t accel) {
+  uint64_t a1 = d1 < 0 ? -d1 : d1;
+  uint64_t a2 = d2 < 0 ? -d2 : d2;
+  if (a1 > UINT32_MAX || a2 > UINT32_MAX || !maxRate || !accel) return false;
+
+  ticks_      = (uint32_t)(a1 > a2 ? a1 : a2);
+  minor_      = (uint32_t)(a1 > a2 ? a2 : a1);
+  major_      = a1 >= a2 ? AXIS1_BIT : AXIS2_BIT;
+  dirBits_    = (d1 > 0 ? AXIS1_BIT : 0) | (d2 > 0 ? AXIS2_BIT : 0);
+  enableBits_ = (d1 ? AXIS1_BIT : 0) | (d2 ? AXIS2_BIT : 0);
+  tick_       = 0;
+  acc_        = ticks_ / 2;
+  ramp_.begin(accel);
+  cruiseUs_   = periodUsQ16(Q16::fromInt(maxRate));
+  // speed at tick k is sqrt(accel * (2k + 1)); cruise once it hits maxRate
+  rampTicks_  = (uint32_t)(((uint64_t)maxRate * maxRate / accel + 1) / 2);
+  return true;
+}
+
+uint32_t LinearMove::intervalAt(uint32_t k) {
+  // distance to the nearer end of the move decides the ramp position
+  uint32_t fromEnd = ticks_ - 1 - k;
+  uint32_t n = k < fromEnd ? k : fromEnd;
+  if (n >= rampTicks_) return cruiseUs_;
+  uint32_t us = ramp_.at(n);
+  return us > cruiseUs_ ? us : cruiseUs_;
+}
+
+bool LinearMove::next(StepTick &t) {
+  if (tick_ >= ticks_) return false;
+  t.mask = major_;
+  acc_  += minor_;
+  if (acc_ >= ticks_) { acc_ -= ticks_; t.mask |= major_ ^ AXIS_ALL; }
+  t.dirBits    = dirBits_;
+  t.enableBits = enableBits_;
+  t.block      = 0;
+  t.intervalUs = intervalAt(tick_);
+  tick_++;
+  return true;
+}
+
+void StopRamp::begin(uint32_t intervalUs, uint32_t accel) {
+  uint64_t rate = 1000000ULL / (intervalUs ? intervalUs : 1);
+  uint64_t v2   = rate * rate;
+  if (v2 > (1UL << 29)) v2 = 1UL << 29;    // keeps accel·(2n+1) in sqrtQ16 range
+  accel  = accel ? accel : 1;
+  n_     = (uint32_t)(v2 / accel / 2);
+  ramp_.begin(accel);
+}
+
+bool StopRamp::next(uint32_t &intervalUs) {
+  if (!n_) return false;
+  n_--;
+  intervalUs = ramp_.at(n_);
+  return true;
+}
+
+void MoveStream::begin(MoveQueue &q, uint32_t accel, uint32_t starveUs) {
+  queue_     = &q;
+  accel_     = accel;
+  starveUs_  = starveUs;
+  seq_       = 0;
+  holdBits_  = 0;
+  inMove_    = false;
+  starving_  = false;
+  completed_ = underruns_ = 0;
+}
+
+// a tick with no steps: DIR as last driven, only held drivers enabled
+void MoveStream::still(StepTick &t, uint32_t us) {
+  t.mask       = 0;
+  t.dirBits    = dirBits_;
+  t.enableBits = holdBits_;
+  t.block      = seq_;
+  t.intervalUs = us;
+}
+
+bool MoveStream::next(StepTick &t) {
+  for (;;) {
+    if (inMove_) {
+      if (move_.next(t)) {
+        t.enableBits |= holdBits_;
+        t.block       = seq_;
+        dirBits_      = t.dirBits;
+        return true;
+      }
+      inMove_ = false;
+      completed_++;
+    }
+
+    PlannerMove m;
+    if (!queue_->pop(m)) {
+      if (queue_->ended()) return false;
+      if (seq_ && !starving_) underruns_++;
+      starving_ = true;
+      still(t, starveUs_);
+      return true;
+    }
+    starving_ = false;
+    seq_++;
+
+    switch (m.kind) {
+      case PLAN_MOVE:
+        // a move the planner cannot take is dropped, not run short
+        inMove_ = move_.begin(m.d1, m.d2, m.value, accel_);
+        if (!inMove_) completed_++;
+        break;
+      case PLAN_DWELL:
+        completed_++;
+        still(t, m.value);
+        return true;
+      case PLAN_HOLD:
+        holdBits_ = m.axes & AXIS_ALL;
+        completed_++;
+        still(t, 0);
+        return true;
+      default:
+        completed_++;
+        break;
+    }
+  }
+}
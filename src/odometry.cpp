@@ -0,0 +1,35 @@
+// src/odometry.cpp
+
+#include "odometry.h"
+
+//—————————————————————————————————————————————
+// Integration
+//—————————————————————————————————————————————
+
+void Odometry::reset(int64_t pos1, int64_t pos2) {
+  last1_ = pos1;
+  last2_ = pos2;
+  xQ16_ = yQ16_ = 0;
+  thetaQ8_ = 0;
+}
+
+void Odometry::update(int64_t pos1, int64_t pos2) {
+  int64_t dl = pos1 - last1_, dr = pos2 - last2_;
+  if (!dl && !dr) return;
+  last1_ = pos1;
+  last2_ = pos2;
+
+  // arc length of the centre point and heading change, evaluated at the
+  // mid-heading of the move
+  int64_t  dsQ16 = (dl + dr) * umPerStepQ16_ / 2;
+  int64_t  dthQ8 = (dr - dl) * bamPerStepQ8_;
+  uint32_t mid   = (uint32_t)((thetaQ8_ + dthQ8 / 2) >> 8);
+  xQ16_    += (dsQ16 * cosQ15(mid)) >> 15;
+  yQ16_    += (dsQ16 * sinQ15(mid)) >> 15;
+  thetaQ8_ += dthQ8;
+}
+
+Pose Odometry::pose() const {
+  return { (int32_t)(xUm() / 1000), (int32_t)(yUm() / 1000),
+           bamToMrad(heading()) };
+}
@@ -0,0 +1,62 @@
+// src/segment_stream.cpp
+
+#include "segment_stream.h"
+
+void SegmentStream::begin(SegmentQueue &q, uint32_t starveUs) {
+  queue_     = &q;
+  starveUs_  = starveUs;
+  blk_       = ScheduleBlock{};
+  seq_       = 0;
+  inBlock_   = false;
+  starving_  = false;
+  completed_ = underruns_ = 0;
+}
+
+bool SegmentStream::next(StepTick &t) {
+  if (!inBlock_) {
+    Segment s;
+    if (!queue_->pop(s)) {
+      if (queue_->ended()) return false;
+      // count a dry queue once per gap, and not while waiting for the first
+      if (seq_ && !starving_) underruns_++;
+      starving_    = true;
+      t.mask       = 0;
+      t.dirBits    = blk_.dirBits;
+      t.enableBits = blk_.enableBits;
+      t.block      = seq_;
+      t.intervalUs = starveUs_;
+      return true;
+    }
+    starving_ = false;
+    compileBlock(blk_, s);
+    seq_++;
+    tick_    = 0;
+    acc_     = blk_.ticks / 2;
+    inBlock_ = true;
+  }
+
+  t.dirBits    = blk_.dirBits;
+  t.enableBits = blk_.enableBits;
+  t.block      = seq_;
+
+  if (!blk_.ticks) {
+    t.mask       = 0;
+    t.intervalUs = blk_.periodUs;
+    inBlock_ = false;
+    completed_++;
+    return true;
+  }
+
+  t.mask = blk_.mask;
+  if (blk_.kind == BLOCK_INTERLEAVED) {
+    acc_ += blk_.aux;
+    if (acc_ >= blk_.ticks) { acc_ -= blk_.ticks; t.mask |= blk_.mask ^ AXIS_ALL; }
+  }
+  t.intervalUs = blk_.periodUs + (tick_ < blk_.remUs ? 1 : 0);
+
+  if (++tick_ >= blk_.ticks) {
+    inBlock_ = false;
+    completed_++;
+  }
+  return true;
+}
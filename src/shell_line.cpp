@@ -0,0 +1,52 @@
+// src/shell_line.cpp
+
+#include "shell_line.h"
+
+bool ShellLine::feed(char c) {
+  if (done_) {                          // the previous line has been read
+    n_    = 0;
+    argc_ = 0;
+    over_ = false;
+    done_ = false;
+  }
+  if (c == '\b' || c == 0x7F) {
+    if (n_) n_--;
+    return false;
+  }
+  if (c != '\r' && c != '\n') {
+    if (c == '\t') c = ' ';
+    if ((uint8_t)c < ' ') return false;
+    if (n_ < SHELL_LINE_MAX) buf_[n_++] = c;
+    else                     over_ = true;
+    return false;
+  }
+
+  // end of line: split into words in place
+  buf_[n_] = 0;
+  for (uint8_t i = 0; i < n_; i++) {
+    if (buf_[i] == ' ') {
+      buf_[i] = 0;
+    } else if (!i || !buf_[i - 1]) {
+      if (argc_ < SHELL_ARGS_MAX) argv_[argc_++] = buf_ + i;
+      else                        over_ = true;
+    }
+  }
+  if (!argc_ && !over_) {               // blank line, or the LF of a CRLF
+    n_ = 0;
+    return false;
+  }
+  done_ = true;
+  return true;
+}
+
+bool parseU32(const char *s, uint32_t &v) {
+  uint64_t n = 0;
+  if (!*s) return false;
+  for (; *s; s++) {
+    if (*s < '0' || *s > '9') return false;
+    n = n * 10 + (uint32_t)(*s - '0');
+    if (n > UINT32_MAX) return false;
+  }
+  v = (uint32_t)n;
+  return true;
+}
@@ -0,0 +1,63 @@
+// src/sim/Arduino.h
+//
+// Arduino core subset used by the firmware, backed by the simulator.
+
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+#define HIGH        1
+#define LOW         0
+#define INPUT       0x01
+#define OUTPUT      0x03
+#define RISING      0x01
+#define FALLING     0x02
+#define CHANGE      0x03
+
+#define IRAM_ATTR
+#define F_CPU       240000000L
+
+void          pinMode(uint8_t pin, uint8_t mode);
+void          digitalWrite(uint8_t pin, uint8_t val);
+int           digitalRead(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void          delay(uint32_t ms);
+void          delayMicroseconds(uint32_t us);
+
+inline int    digitalPinToInterrupt(int pin) { return pin; }
+void          attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void          detachInterrupt(uint8_t pin);
+
+class HardwareSerial {
+ public:
+  void   begin(unsigned long baud);
+  int    available();
+  int    read();
+  int    availableForWrite();
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buf, size_t n);
+  size_t print(const char *s);
+  size_t println(const char *s = "");
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+  void   flush() {}
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+ public:
+  uint32_t getCycleCount();               // virtual clock × F_CPU
+};
+
+extern EspClass ESP;
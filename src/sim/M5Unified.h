@@ -0,0 +1,52 @@
+// src/sim/M5Unified.h
+//
+// The simulator has no screen: display calls keep only the text drawn
+// since the last fillScreen() and a count of those redraws, for checks.
+
+#pragma once
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+enum : uint16_t {
+  BLACK  = 0x0000,
+  RED    = 0xF800,
+  GREEN  = 0x07E0,
+  YELLOW = 0xFFE0,
+  WHITE  = 0xFFFF,
+};
+
+class SimLcd {
+ public:
+  void setBrightness(uint8_t) {}
+  void fillScreen(uint16_t) {
+    frames++;
+    text[0] = 0;
+  }
+  void setTextSize(uint8_t) {}
+  void setTextColor(uint16_t, uint16_t = BLACK) {}
+  void setCursor(int32_t, int32_t) {}
+  void print(const char *s) { printf("%s", s); }
+  void println(const char *s = "") { printf("%s\n", s); }
+  void printf(const char *fmt, ...) {
+    size_t  n = strlen(text);
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(text + n, sizeof(text) - n, fmt, ap);
+    va_end(ap);
+  }
+
+  uint32_t frames   = 0;                // fillScreen() calls
+  char     text[512] = {};              // screen contents since the last
+};
+
+class SimM5 {
+ public:
+  SimLcd Lcd;
+  void begin() {}
+  void update() {}
+};
+
+extern SimM5 M5;
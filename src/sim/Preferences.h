@@ -0,0 +1,33 @@
+// src/sim/Preferences.h
+//
+// NVS key/value store over the simulator's in-memory flash.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Preferences {
+ public:
+  bool     begin(const char *name, bool readOnly = false);
+  void     end();
+  bool     clear();
+  bool     remove(const char *key);
+  bool     isKey(const char *key);
+
+  size_t   putUChar(const char *key, uint8_t value);
+  size_t   putUShort(const char *key, uint16_t value);
+  size_t   putUInt(const char *key, uint32_t value);
+  size_t   putBytes(const char *key, const void *value, size_t len);
+
+  uint8_t  getUChar(const char *key, uint8_t defaultValue = 0);
+  uint16_t getUShort(const char *key, uint16_t defaultValue = 0);
+  uint32_t getUInt(const char *key, uint32_t defaultValue = 0);
+  size_t   getBytesLength(const char *key);
+  size_t   getBytes(const char *key, void *buf, size_t maxLen);
+
+ private:
+  char ns_[16]   = "";
+  bool open_     = false;
+  bool readOnly_ = true;
+};
@@ -0,0 +1,35 @@
+// src/sim/XboxSeriesXControllerESP32_asukiaaa.hpp
+//
+// Controller library stand-in: the notification fields the firmware
+// reads, filled in by a simulator script instead of BLE.
+
+#pragma once
+
+#include <stdint.h>
+
+class XboxControllerNotificationParser {
+ public:
+  bool btnA, btnB, btnX, btnY;
+  bool btnShare, btnStart, btnSelect, btnXbox;
+  bool btnLB, btnRB, btnLS, btnRS;
+  bool btnDirUp, btnDirLeft, btnDirRight, btnDirDown;
+  uint16_t joyLHori, joyLVert, joyRHori, joyRVert;
+  uint16_t trigLT, trigRT;
+
+  static const uint16_t maxJoy  = 0xffff;
+  static const uint16_t maxTrig = 0x3ff;
+};
+
+namespace XboxSeriesXControllerESP32_asukiaaa {
+
+class Core {
+ public:
+  XboxControllerNotificationParser &xboxNotif;
+
+  Core();
+  void begin() {}
+  void onLoop();
+  bool isConnected();
+};
+
+}  // namespace XboxSeriesXControllerESP32_asukiaaa
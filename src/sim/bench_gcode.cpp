@@ -0,0 +1,140 @@
+// src/sim/bench_gcode.cpp
+//
+// G-code throughput benchmark: feeds a program through GcodeParser and
+// GcodeInterpreter a character at a time, exactly as the GCODE command
+// does, and prints one JSON object:
+//
+//   .pio/build/native/program gcode-bench [-n runs] [file]
+//
+// Without a file it synthesises a CAM-style program (comments, line
+// numbers, G0 travel, long G1 contours with three decimals, dwells). The
+// program is kept in memory and passed over -n times (default 20) so the
+// clock reads parsing, not I/O. checksum folds every move emitted and
+// errors counts bad lines; both are deterministic and catch a parser
+// change that alters the output.
+//
+//   lines_per_s, mb_per_s  host throughput over all runs
+//   parser_bytes           sizeof(GcodeParser): all state a stream needs
+//   interpreter_bytes      sizeof(GcodeInterpreter)
+
+#include "diff_drive.h"
+#include "gcode.h"
+#include "robot_config.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+static const DiffDrive BENCH_DRIVE(STEPS_PER_REV, WHEEL_DIA_MM, TRACK_MM);
+
+static uint32_t rngState = 7;
+static uint32_t rnd(uint32_t n) {
+  rngState = rngState * 1664525u + 1013904223u;
+  return (rngState >> 8) % n;
+}
+
+static void coord(std::string &s, char axis, long um) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), " %c%s%ld.%03ld", axis, um < 0 ? "-" : "",
+           labs(um) / 1000, labs(um) % 1000);
+  s += buf;
+}
+
+// pockets of short contour moves joined by rapids, the shape a CAM
+// post-processor emits
+static std::string synthProgram() {
+  std::string s = "%\n(bench program)\nG21 G90\nM17\n";
+  char buf[48];
+  long n = 10, x = 0, y = 0;
+  for (int pocket = 0; pocket < 40; pocket++) {
+    x = (long)rnd(200000) - 100000;
+    y = (long)rnd(200000) - 100000;
+    snprintf(buf, sizeof(buf), "N%ld G0", n += 10);
+    s += buf;
+    coord(s, 'X', x);
+    coord(s, 'Y', y);
+    s += "\n";
+    snprintf(buf, sizeof(buf), "N%ld G1 F%u.0 ; plunge\n", n += 10, 300 + rnd(1200));
+    s += buf;
+    for (int k = 0; k < 120; k++) {
+      x += (long)rnd(4001) - 2000;
+      y += (long)rnd(4001) - 2000;
+      snprintf(buf, sizeof(buf), "N%ld G1", n += 10);
+      s += buf;
+      coord(s, 'X', x);
+      coord(s, 'Y', y);
+      s += "\n";
+    }
+    s += "G4 P250\n";
+  }
+  s += "M18\nM30\n%\n";
+  return s;
+}
+
+static bool readFile(const char *path, std::string &out) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  char   buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+  fclose(f);
+  return true;
+}
+
+int benchGcode(int argc, char **argv) {
+  const char *path = nullptr;
+  int         runs = 20;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-n") && i + 1 < argc) runs = atoi(argv[++i]);
+    else                                        path = argv[i];
+  }
+  if (runs < 1) runs = 1;
+
+  std::string program;
+  if (!path) {
+    program = synthProgram();
+  } else if (!readFile(path, program)) {
+    fprintf(stderr, "%s: cannot read\n", path);
+    return 2;
+  }
+
+  GcodeParser      parser;
+  GcodeInterpreter interp(BENCH_DRIVE, MAX_SAFE_RATE);
+  uint64_t lines = 0, moves = 0, errors = 0;
+  uint32_t checksum = 2166136261u;
+
+  auto wall0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < runs; r++) {
+    parser.reset();
+    interp.begin(0, 0);
+    for (char c : program) {
+      if (!parser.feed(c)) continue;
+      lines++;
+      PlannerMove m;
+      if (interp.apply(parser.line(), m)) {
+        errors++;
+        continue;
+      }
+      if (m.kind == PLAN_NONE) continue;
+      moves++;
+      uint32_t v[5] = { m.kind, m.axes, (uint32_t)m.d1, (uint32_t)m.d2, m.value };
+      for (uint32_t w : v) checksum = (checksum ^ w) * 16777619u;
+    }
+  }
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+  double bytes = (double)program.size() * runs;
+
+  printf("{\"program\":\"%s\",\"runs\":%d,\"lines\":%llu,\"bytes\":%llu,\"moves\":%llu,"
+         "\"errors\":%llu,\"seconds\":%.4f,\"lines_per_s\":%.0f,\"mb_per_s\":%.2f,"
+         "\"parser_bytes\":%u,\"interpreter_bytes\":%u,\"checksum\":\"%08x\"}\n",
+         path ? path : "synthetic", runs, (unsigned long long)(lines / runs),
+         (unsigned long long)program.size(), (unsigned long long)(moves / runs),
+         (unsigned long long)(errors / runs), wallS,
+         wallS > 0 ? lines / wallS : 0.0, wallS > 0 ? bytes / wallS / 1e6 : 0.0,
+         (unsigned)sizeof(GcodeParser), (unsigned)sizeof(GcodeInterpreter),
+         (unsigned)checksum);
+  fflush(stdout);
+  return 0;
+}
@@ -0,0 +1,273 @@
+// src/sim/bench_playback.cpp
+//
+// Playback timing benchmark: plays a fixed corpus of segment sets through
+// playbackSequence() on the virtual clock, timestamps every STEP edge and
+// prints one JSON object per case:
+//
+//   .pio/build/native/program bench [-v] [--vcd file] [case ...]
+//
+// Times are exact virtual microseconds, so every field except
+// engine_steps_per_s is deterministic and a run can be diffed against a
+// saved baseline. -v shows the firmware's Serial output, --vcd dumps the
+// driver pins of the cases run. Exits non-zero if any case loses or gains
+// steps.
+//
+//   duration_err_us    actual − recorded run time (durations + settle gaps)
+//   dist_err_steps     per axis, worst |steps done − steps due| at an edge,
+//                      against an even spread over the segment's duration
+//   max_gap_us         per axis, longest time between two steps inside a
+//                      segment; gap_excess_us is how far past the even
+//                      spacing (rounded up) that was
+//   steps_per_s        STEP edges per virtual second
+//   engine_steps_per_s STEP edges per wall-clock second on this host
+
+#include "sim.h"
+#include "deferred_log.h"
+#include "robot_config.h"
+#include "segment.h"
+
+#include <Arduino.h>
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+struct PlaybackSnapshot;
+void setup();
+void playbackSequence(bool reverse, const PlaybackSnapshot *resume);
+void writeLogLine(const char *line, size_t len);
+
+extern Segment     segments[MAX_SEGMENTS];
+extern uint16_t    segmentCount;
+extern bool        scheduleValid;
+extern DeferredLog dlog;
+
+static const int      STEP_PINS[2]   = { STEP1_PIN, STEP2_PIN };
+
+typedef std::vector<Segment> SegmentSet;
+
+//—————————————————————————————————————————————
+// Corpus
+//—————————————————————————————————————————————
+
+static uint32_t rngState;
+static uint32_t rnd(uint32_t n) {
+  rngState = rngState * 1664525u + 1013904223u;
+  return (rngState >> 8) % n;
+}
+
+static Segment seg(long p1, long p2, unsigned long ms, int8_t d1 = 1, int8_t d2 = 1) {
+  return { p1 ? d1 : (int8_t)0, p2 ? d2 : (int8_t)0, p1, p2, ms };
+}
+
+// a full buffer of the short bursts stick jitter leaves behind
+static SegmentSet jitter() {
+  SegmentSet s;
+  rngState = 42;
+  for (int i = 0; i < MAX_SEGMENTS; i++) {
+    unsigned long ms = 20 + rnd(60);
+    long p1 = rnd(2 * ms + 1), p2 = rnd(2 * ms + 1);
+    s.push_back(seg(p1, p2, ms, rnd(2) ? 1 : -1, rnd(2) ? 1 : -1));
+  }
+  return s;
+}
+
+// long straight runs and spins at 1600 steps/s
+static SegmentSet cruise() {
+  return { seg(24000, 24000, 15000), seg(24000, 24000, 15000, 1, -1),
+           seg(24000, 24000, 15000, -1, -1), seg(24000, 24000, 15000, -1, 1) };
+}
+
+// unequal axis rates: the minor axis is spread across the major's ticks
+static SegmentSet ratios() {
+  return { seg(2000, 1000, 2000), seg(1999, 1000, 2000), seg(1000, 999, 2000),
+           seg(3000, 7, 2000),    seg(7, 3000, 2000),    seg(4000, 1, 2000),
+           seg(1, 4000, 2000, -1, 1), seg(3001, 2999, 2000, 1, -1) };
+}
+
+// more unequal ticks than the mask arena holds: later blocks interleave
+static SegmentSet interleaved() {
+  SegmentSet s;
+  for (int i = 0; i < 8; i++) {
+    s.push_back(i & 1 ? seg(13001, 20000, 10000, -1, 1) : seg(20000, 13001, 10000));
+  }
+  return s;
+}
+
+// stops between moves, some longer than the input poll interval
+static SegmentSet dwells() {
+  return { seg(500, 500, 500), seg(0, 0, 5),    seg(300, 200, 400, -1, 1),
+           seg(0, 0, 2500),    seg(800, 0, 600), seg(0, 0, 9),
+           seg(0, 800, 600),   seg(0, 0, 12000), seg(100, 100, 100, -1, -1) };
+}
+
+// durations that do not divide evenly into ticks
+static SegmentSet remainders() {
+  return { seg(613, 97, 997), seg(7, 7, 1001), seg(1999, 1998, 1003, -1, 1),
+           seg(3, 1, 7), seg(997, 0, 1999), seg(0, 1009, 1013, 1, -1) };
+}
+
+// rates beyond MIN_STEP_INTERVAL_US: playback has to stretch these
+static SegmentSet overspeed() {
+  return { seg(6000, 3000, 1000), seg(2500, 2500, 1000), seg(3000, 6000, 1000, -1, -1) };
+}
+
+struct BenchCase {
+  const char *name;
+  SegmentSet (*build)();
+};
+
+static const BenchCase CASES[] = {
+  { "jitter",      jitter },
+  { "cruise",      cruise },
+  { "ratios",      ratios },
+  { "interleaved", interleaved },
+  { "dwells",      dwells },
+  { "remainders",  remainders },
+  { "overspeed",   overspeed },
+};
+static const size_t CASE_COUNT = sizeof(CASES) / sizeof(CASES[0]);
+
+//—————————————————————————————————————————————
+// Measurement
+//—————————————————————————————————————————————
+
+static std::vector<uint64_t> rises[2];   // STEP rising edges per axis
+
+static void onPin(int pin, int level, uint64_t nowUs) {
+  if (!level) return;
+  for (int a = 0; a < 2; a++) {
+    if (pin == STEP_PINS[a]) rises[a].push_back(nowUs);
+  }
+}
+
+struct BenchResult {
+  uint64_t plannedUs, actualUs;
+  uint32_t steps[2], expected[2];
+  double   distErr[2];
+  uint32_t maxGapUs[2], gapExcessUs[2];
+  double   wallS;
+};
+
+static uint32_t pulses(const Segment &s, int a) {
+  long p = a ? s.pulses2 : s.pulses1;
+  return p > 0 ? (uint32_t)p : 0;
+}
+
+// per-segment spread and gaps; edges are assigned to segments in order,
+// so only meaningful when the step counts came out right
+static void analyse(const SegmentSet &set, BenchResult &r) {
+  uint32_t base[2] = { 0, 0 };
+  for (const Segment &s : set) {
+    uint32_t p[2]  = { pulses(s, 0), pulses(s, 1) };
+    uint64_t durUs = (uint64_t)s.durationMs * 1000;
+    if (p[0] || p[1]) {
+      int      major = p[0] >= p[1] ? 0 : 1;
+      uint64_t start = rises[major][base[major]];   // the block's first tick
+      for (int a = 0; a < 2; a++) {
+        uint32_t evenUs = (uint32_t)((durUs + p[a] - 1) / (p[a] ? p[a] : 1));
+        for (uint32_t k = 0; k < p[a]; k++) {
+          uint64_t t   = rises[a][base[a] + k];
+          double   due = (double)(t - start) * p[a] / (double)durUs;
+          double   err = fabs(due - k);
+          if (err > r.distErr[a]) r.distErr[a] = err;
+          if (!k) continue;
+          uint32_t gap = (uint32_t)(t - rises[a][base[a] + k - 1]);
+          if (gap > r.maxGapUs[a]) r.maxGapUs[a] = gap;
+          if (gap > evenUs && gap - evenUs > r.gapExcessUs[a]) r.gapExcessUs[a] = gap - evenUs;
+        }
+      }
+    }
+    base[0] += p[0];
+    base[1] += p[1];
+  }
+}
+
+static BenchResult runCase(const SegmentSet &set) {
+  BenchResult r = {};
+  segmentCount  = (uint16_t)set.size();
+  memcpy(segments, set.data(), sizeof(Segment) * set.size());
+  scheduleValid = false;
+  for (const Segment &s : set) {
+    r.plannedUs   += (uint64_t)s.durationMs * 1000 + SEGMENT_GAP_US;
+    r.expected[0] += pulses(s, 0);
+    r.expected[1] += pulses(s, 1);
+  }
+  rises[0].clear();
+  rises[1].clear();
+
+  auto     wall0 = std::chrono::steady_clock::now();
+  uint64_t t0    = sim::nowUs();
+  playbackSequence(false, nullptr);
+  r.actualUs = sim::nowUs() - t0;
+  r.wallS    = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+
+  r.steps[0] = (uint32_t)rises[0].size();
+  r.steps[1] = (uint32_t)rises[1].size();
+  if (r.steps[0] == r.expected[0] && r.steps[1] == r.expected[1]) analyse(set, r);
+  return r;
+}
+
+static void printResult(const char *name, size_t count, const BenchResult &r) {
+  double steps = (double)r.steps[0] + r.steps[1];
+  printf("{\"case\":\"%s\",\"segments\":%u,\"steps\":[%lu,%lu],\"expected_steps\":[%lu,%lu],"
+         "\"planned_us\":%llu,\"actual_us\":%llu,\"duration_err_us\":%lld,"
+         "\"dist_err_steps\":[%.3f,%.3f],\"max_gap_us\":[%lu,%lu],\"gap_excess_us\":[%lu,%lu],"
+         "\"steps_per_s\":%.1f,\"engine_steps_per_s\":%.0f}\n",
+         name, (unsigned)count,
+         (unsigned long)r.steps[0], (unsigned long)r.steps[1],
+         (unsigned long)r.expected[0], (unsigned long)r.expected[1],
+         (unsigned long long)r.plannedUs, (unsigned long long)r.actualUs,
+         (long long)r.actualUs - (long long)r.plannedUs,
+         r.distErr[0], r.distErr[1],
+         (unsigned long)r.maxGapUs[0], (unsigned long)r.maxGapUs[1],
+         (unsigned long)r.gapExcessUs[0], (unsigned long)r.gapExcessUs[1],
+         r.actualUs ? steps * 1e6 / r.actualUs : 0.0,
+         r.wallS > 0 ? steps / r.wallS : 0.0);
+}
+
+//—————————————————————————————————————————————
+// Entry
+//—————————————————————————————————————————————
+
+int benchPlayback(int argc, char **argv) {
+  bool        verbose = false;
+  const char *vcdPath = nullptr;
+  std::vector<const BenchCase *> picked;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-v")) { verbose = true; continue; }
+    if (!strcmp(argv[i], "--vcd") && i + 1 < argc) { vcdPath = argv[++i]; continue; }
+    size_t c = 0;
+    while (c < CASE_COUNT && strcmp(argv[i], CASES[c].name)) c++;
+    if (c == CASE_COUNT) {
+      fprintf(stderr, "unknown case '%s'\n", argv[i]);
+      return 2;
+    }
+    picked.push_back(&CASES[c]);
+  }
+  if (picked.empty()) {
+    for (const BenchCase &c : CASES) picked.push_back(&c);
+  }
+
+  sim::serialEcho(verbose);
+  setup();
+  sim::setPinHook(onPin);
+  if (vcdPath && !sim::vcdOpen(vcdPath, sim::MOTOR_SIGNALS, sim::MOTOR_SIGNAL_COUNT)) {
+    fprintf(stderr, "%s: cannot write\n", vcdPath);
+    return 2;
+  }
+
+  int failed = 0;
+  for (const BenchCase *c : picked) {
+    SegmentSet  set = c->build();
+    BenchResult r   = runCase(set);
+    dlog.drain(writeLogLine);           // the firmware's lines, if -v
+    printResult(c->name, set.size(), r);
+    if (r.steps[0] != r.expected[0] || r.steps[1] != r.expected[1]) failed++;
+  }
+  sim::vcdClose();
+  fflush(stdout);
+  return failed ? 1 : 0;
+}
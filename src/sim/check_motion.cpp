@@ -0,0 +1,369 @@
+// src/sim/check_motion.cpp
+//
+// Motion regression checks: pure host runs of the motion library, no
+// firmware loop and no clock, that print one JSON object per case and
+// exit non-zero if any fails:
+//
+//   .pio/build/native/program check [case ...]
+//
+//   retrace   each segment set is compiled, run forward through a
+//             ScheduleCursor into AxisPositions, then retraced with the
+//             reverse cursor; forward must land on the recorded
+//             displacement and the retrace back on 0, 0 exactly. With
+//             the settle gap in, both walks must take the same ticks and
+//             time and step on their first tick (every set starts and
+//             ends moving)
+//   odometry  closed paths (out and back, a square, a full circle) are
+//             planned as LinearMoves, stepped into AxisPositions and
+//             folded into Odometry at the poll cadence; the pose must
+//             come back to the start within ODOM_TOL_UM / ODOM_TOL_MRAD
+//   gcode     short programs through GcodeParser and GcodeInterpreter:
+//             each move's step rate must match the feed exactly, and an
+//             F far past the machine (up to the parser's largest number)
+//             on the longest legal move must run at the rate cap, not
+//             wrap to a crawl
+//   trace     an input trace captured past its ring, and one that is
+//             not, exported with writeInputTrace() and read back the way
+//             --replay reads it: the CRC must hold and every sample,
+//             the tail included, must come back unchanged
+
+#include "axis_position.h"
+#include "diff_drive.h"
+#include "gcode.h"
+#include "input_trace.h"
+#include "move_planner.h"
+#include "odometry.h"
+#include "robot_config.h"
+#include "segment.h"
+#include "step_schedule.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+typedef std::vector<Segment> SegmentSet;
+
+static uint32_t rngState;
+static uint32_t rnd(uint32_t n) {
+  rngState = rngState * 1664525u + 1013904223u;
+  return (rngState >> 8) % n;
+}
+
+static Segment seg(long p1, long p2, unsigned long ms, int8_t d1 = 1, int8_t d2 = 1) {
+  return { p1 ? d1 : (int8_t)0, p2 ? d2 : (int8_t)0, p1, p2, ms };
+}
+
+//—————————————————————————————————————————————
+// Retrace
+//—————————————————————————————————————————————
+
+struct RetraceSet {
+  const char *name;
+  SegmentSet (*build)();
+};
+
+static SegmentSet straight() {
+  return { seg(3000, 3000, 2000), seg(1200, 1200, 800, -1, -1) };
+}
+
+// turns in place and arcs, both axes reversing between segments
+static SegmentSet spins() {
+  return { seg(800, 800, 500, 1, -1), seg(400, 1300, 900), seg(800, 800, 500, -1, 1),
+           seg(1300, 400, 900, -1, -1), seg(0, 0, 50), seg(90, 0, 60, -1, 1) };
+}
+
+// uneven ratios, packed into the mask arena
+static SegmentSet ratios() {
+  return { seg(2000, 1000, 2000), seg(1999, 1000, 2000, -1, 1), seg(3000, 7, 2000),
+           seg(7, 3000, 2000, 1, -1), seg(3001, 2999, 2000, -1, -1) };
+}
+
+// past the arena: later blocks interleave on the fly in both directions
+static SegmentSet overflow() {
+  SegmentSet s;
+  for (int i = 0; i < 8; i++) {
+    s.push_back(i & 1 ? seg(13001, 20000, 10000, -1, 1) : seg(20000, 13001, 10000, 1, -1));
+  }
+  return s;
+}
+
+// a full buffer of random short bursts, as stick jitter records them
+static SegmentSet jitter() {
+  SegmentSet s;
+  rngState = 29;
+  for (int i = 0; i < MAX_SEGMENTS; i++) {
+    unsigned long ms = 20 + rnd(60);
+    long p1 = rnd(2 * ms + 1), p2 = rnd(2 * ms + 1);
+    s.push_back(seg(p1, p2, ms, rnd(2) ? 1 : -1, rnd(2) ? 1 : -1));
+  }
+  return s;
+}
+
+static const RetraceSet RETRACE_SETS[] = {
+  { "straight", straight }, { "spins", spins },   { "ratios", ratios },
+  { "overflow", overflow }, { "jitter", jitter },
+};
+
+static StepSchedule schedule;           // too big for the stack
+
+struct CursorRun {
+  uint64_t ticks, us;
+  uint64_t leadUs;                      // before the first step
+};
+
+static CursorRun runCursor(AxisPositions &pos, bool reverse) {
+  ScheduleCursor c;
+  StepTick       t;
+  CursorRun      r = { 0, 0, 0 };
+  bool           stepped = false;
+  c.begin(schedule, reverse, SEGMENT_GAP_US);
+  while (c.next(t)) {
+    if (t.mask) stepped = true;
+    if (!stepped) r.leadUs += t.intervalUs;
+    pos.step(t.mask, t.dirBits);
+    r.ticks++;
+    r.us += t.intervalUs;
+  }
+  return r;
+}
+
+static bool checkRetrace(const RetraceSet &rs) {
+  SegmentSet segs = rs.build();
+  compileSchedule(schedule, segs.data(), (uint16_t)segs.size());
+
+  int64_t want1 = 0, want2 = 0;
+  for (const Segment &s : segs) {
+    want1 += (int64_t)s.dir1 * s.pulses1;
+    want2 += (int64_t)s.dir2 * s.pulses2;
+  }
+
+  AxisPositions pos;
+  int64_t f1, f2, e1, e2;
+  CursorRun fwd = runCursor(pos, false);
+  pos.read(f1, f2);
+  CursorRun rev = runCursor(pos, true);
+  pos.read(e1, e2);
+
+  bool ok = f1 == want1 && f2 == want2 && !e1 && !e2 &&
+            fwd.ticks == rev.ticks && fwd.us == rev.us && !fwd.leadUs && !rev.leadUs;
+  printf("{\"check\":\"retrace\",\"case\":\"%s\",\"segments\":%u,\"mask_bytes\":%lu,"
+         "\"forward\":[%lld,%lld],\"expected\":[%lld,%lld],\"end\":[%lld,%lld],"
+         "\"ticks\":[%llu,%llu],\"us\":[%llu,%llu],\"lead_us\":[%llu,%llu],\"ok\":%s}\n",
+         rs.name, (unsigned)segs.size(), (unsigned long)schedule.maskBytes,
+         (long long)f1, (long long)f2, (long long)want1, (long long)want2,
+         (long long)e1, (long long)e2, (unsigned long long)fwd.ticks,
+         (unsigned long long)rev.ticks, (unsigned long long)fwd.us,
+         (unsigned long long)rev.us, (unsigned long long)fwd.leadUs,
+         (unsigned long long)rev.leadUs, ok ? "true" : "false");
+  return ok;
+}
+
+//—————————————————————————————————————————————
+// Odometry
+//—————————————————————————————————————————————
+
+// legs are whole wheel steps, so a closed path misses by rounding only
+// (tens of µm today); a miss past a few wheel steps means broken math
+static const int64_t  ODOM_TOL_UM     = 500;
+static const int32_t  ODOM_TOL_MRAD   = 5;
+static const uint32_t ODOM_POLL_TICKS = 16;   // update() every this many ticks
+
+struct OdomLeg {
+  int64_t d1, d2;                       // wheel steps, motor 1 = left
+};
+
+struct OdomPath {
+  const char          *name;
+  std::vector<OdomLeg> (*build)(const Odometry &o);
+};
+
+static std::vector<OdomLeg> outAndBack(const Odometry &o) {
+  int64_t s = o.driveSteps(1000000);
+  return { { s, s }, { -s, -s } };
+}
+
+// 500 mm sides, quarter turns in place to the left
+static std::vector<OdomLeg> square(const Odometry &o) {
+  int64_t s = o.driveSteps(500000), t = o.spinSteps((int32_t)BAM_QUARTER);
+  std::vector<OdomLeg> legs;
+  for (int i = 0; i < 4; i++) {
+    legs.push_back({ s, s });
+    legs.push_back({ -t, t });
+  }
+  return legs;
+}
+
+// one full left circle of 300 mm radius, as a single arc
+static std::vector<OdomLeg> circle(const Odometry &o) {
+  double r = 300000.0, half = TRACK_MM * 500.0;
+  int64_t l = o.driveSteps((int64_t)llround(2 * M_PI * (r - half)));
+  int64_t rr = o.driveSteps((int64_t)llround(2 * M_PI * (r + half)));
+  return { { l, rr } };
+}
+
+static const OdomPath ODOM_PATHS[] = {
+  { "out_and_back", outAndBack }, { "square", square }, { "circle", circle },
+};
+
+static bool checkOdometry(const OdomPath &p) {
+  Odometry      odom(STEPS_PER_REV, WHEEL_DIA_MM, TRACK_MM);
+  AxisPositions pos;
+  odom.reset(0, 0);
+
+  std::vector<OdomLeg> legs = p.build(odom);
+  uint64_t ticks = 0;
+  for (const OdomLeg &leg : legs) {
+    LinearMove m;
+    StepTick   t;
+    if (!m.begin(leg.d1, leg.d2, MAX_SAFE_RATE, MAX_ACCEL_STEPS_S2)) return false;
+    while (m.next(t)) {
+      pos.step(t.mask, t.dirBits);
+      if (++ticks % ODOM_POLL_TICKS) continue;
+      int64_t p1, p2;
+      pos.read(p1, p2);
+      odom.update(p1, p2);
+    }
+    int64_t p1, p2;
+    pos.read(p1, p2);
+    odom.update(p1, p2);
+  }
+
+  int64_t x = odom.xUm(), y = odom.yUm();
+  int64_t dist = (int64_t)llround(sqrt((double)x * x + (double)y * y));
+  int32_t th   = bamToMrad(odom.heading());
+  bool ok = dist <= ODOM_TOL_UM && th <= ODOM_TOL_MRAD && th >= -ODOM_TOL_MRAD;
+  printf("{\"check\":\"odometry\",\"case\":\"%s\",\"legs\":%u,\"ticks\":%llu,"
+         "\"end_um\":[%lld,%lld],\"miss_um\":%lld,\"heading_mrad\":%ld,\"ok\":%s}\n",
+         p.name, (unsigned)legs.size(), (unsigned long long)ticks, (long long)x,
+         (long long)y, (long long)dist, (long)th, ok ? "true" : "false");
+  return ok;
+}
+
+//—————————————————————————————————————————————
+// G-code
+//—————————————————————————————————————————————
+
+static const DiffDrive CHECK_DRIVE(STEPS_PER_REV, WHEEL_DIA_MM, TRACK_MM);
+
+struct GcodeCase {
+  const char *name;
+  const char *program;                  // its last line is the move checked
+  uint32_t    rate;                     // expected steps/s of that move
+};
+
+// G1 along X: feed µm/min over 60 s, in steps of the major axis
+static uint32_t feedRate(int64_t um, int64_t feedUmMin) {
+  int64_t steps = CHECK_DRIVE.umToSteps(um);
+  return (uint32_t)(steps * feedUmMin / (60 * um));
+}
+
+static bool checkGcode(const GcodeCase &c) {
+  GcodeParser      parser;
+  GcodeInterpreter interp(CHECK_DRIVE, MAX_SAFE_RATE);
+  PlannerMove      last = {};
+  uint32_t         errors = 0;
+  parser.reset();
+  interp.begin(0, 0);
+  for (const char *p = c.program; *p; p++) {
+    if (!parser.feed(*p)) continue;
+    PlannerMove m;
+    if (interp.apply(parser.line(), m)) errors++;
+    else if (m.kind == PLAN_MOVE)       last = m;
+  }
+  bool ok = !errors && last.kind == PLAN_MOVE && last.value == c.rate;
+  printf("{\"check\":\"gcode\",\"case\":\"%s\",\"errors\":%lu,\"steps\":[%ld,%ld],"
+         "\"rate\":%lu,\"expected\":%lu,\"ok\":%s}\n",
+         c.name, (unsigned long)errors, (long)last.d1, (long)last.d2,
+         (unsigned long)last.value, (unsigned long)c.rate, ok ? "true" : "false");
+  return ok;
+}
+
+static bool checkGcodeCases() {
+  const GcodeCase cases[] = {
+    { "feed",       "G1 X10 F600\n",                              feedRate(10000, 600000) },
+    { "slow_long",  "G1 X500 F100\n",                             feedRate(500000, 100000) },
+    { "huge_feed",  "G1 X1000 F999999999.999\n",                  MAX_SAFE_RATE },
+    { "huge_long",  "G0 X-1000000\nG1 X1000000 F999999999.999\n", MAX_SAFE_RATE },
+  };
+  bool ok = true;
+  for (const GcodeCase &c : cases) ok &= checkGcode(c);
+  return ok;
+}
+
+//—————————————————————————————————————————————
+// Input Trace
+//—————————————————————————————————————————————
+
+bool readInputTrace(FILE *f, InputTrace &t, const char *name);   // sim_main.cpp
+
+static InputTrace captured, reloaded;   // too big for the stack
+
+static void traceToFile(const char *line, void *f) { fprintf((FILE *)f, "%s\n", line); }
+
+static bool sameSample(const InputSample &a, const InputSample &b) {
+  return a.tUs == b.tUs && a.buttons == b.buttons && a.joyLVert == b.joyLVert &&
+         a.joyRHori == b.joyRHori && a.trigLT == b.trigLT && a.trigRT == b.trigRT;
+}
+
+// capture frames distinct input states 20 ms apart, export them just after
+static bool checkTrace(const char *name, uint32_t frames) {
+  uint32_t endUs = 1000 + frames * 20000 + 5000;
+  captured.begin(1000);
+  for (uint32_t i = 0; i < frames; i++) {
+    InputFrame f = { 1000 + i * 20000, (uint32_t)(i & 1 ? BTN_BIT(0) : 0), (uint16_t)(i * 7),
+                     0x8000, 0, (uint16_t)i };
+    captured.capture(f, true);
+  }
+  FILE *f = tmpfile();
+  bool  ok = f != nullptr;
+  if (ok) {
+    writeInputTrace(captured, endUs, traceToFile, f);
+    rewind(f);
+    ok = readInputTrace(f, reloaded, name);
+    fclose(f);
+  }
+  uint32_t bad = 0;
+  if (ok) {
+    ok = reloaded.count() == captured.count() + 1;
+    for (uint32_t i = 0; ok && i < reloaded.count(); i++) {
+      InputSample want = i < captured.count() ? captured.at(i) : captured.tail(endUs);
+      if (!sameSample(reloaded.at(i), want)) bad++;
+    }
+    ok = ok && !bad;
+  }
+  printf("{\"check\":\"trace\",\"case\":\"%s\",\"captured\":%lu,\"dropped\":%lu,"
+         "\"loaded\":%lu,\"mismatched\":%lu,\"ok\":%s}\n",
+         name, (unsigned long)captured.count(), (unsigned long)captured.dropped(),
+         (unsigned long)reloaded.count(), (unsigned long)bad, ok ? "true" : "false");
+  return ok;
+}
+
+//—————————————————————————————————————————————
+// Entry
+//—————————————————————————————————————————————
+
+static bool wanted(int argc, char **argv, const char *name) {
+  if (argc < 2) return true;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], name)) return true;
+  }
+  return false;
+}
+
+int checkMotion(int argc, char **argv) {
+  int failed = 0;
+  if (wanted(argc, argv, "retrace")) {
+    for (const RetraceSet &rs : RETRACE_SETS) failed += !checkRetrace(rs);
+  }
+  if (wanted(argc, argv, "odometry")) {
+    for (const OdomPath &p : ODOM_PATHS) failed += !checkOdometry(p);
+  }
+  if (wanted(argc, argv, "gcode")) failed += !checkGcodeCases();
+  if (wanted(argc, argv, "trace")) {
+    failed += !checkTrace("partial", INPUT_TRACE_SAMPLES / 2);
+    failed += !checkTrace("wrapped", INPUT_TRACE_SAMPLES + 300);
+  }
+  fflush(stdout);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,411 @@
+// src/sim/sim.cpp
+
+#include "sim.h"
+
+#include <Arduino.h>
+#include <M5Unified.h>
+#include <Preferences.h>
+#include <XboxSeriesXControllerESP32_asukiaaa.hpp>
+#include <soc/gpio_struct.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+HardwareSerial Serial;
+EspClass       ESP;
+SimM5          M5;
+gpio_dev_t     GPIO;
+
+//—————————————————————————————————————————————
+// Clock
+//—————————————————————————————————————————————
+
+typedef std::chrono::steady_clock WallClock;
+
+static uint64_t              clockUs = 0;
+static bool                  paced   = false;
+static uint64_t              paceUs  = 0;        // virtual time at realtime(true)
+static WallClock::time_point paceWall;
+
+// sleep off any lead of the virtual clock over the wall clock
+static void pace() {
+  if (!paced) return;
+  uint64_t wallUs = paceUs + (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                                 WallClock::now() - paceWall).count();
+  if (clockUs > wallUs + 1000) std::this_thread::sleep_for(std::chrono::microseconds(clockUs - wallUs));
+}
+
+uint64_t sim::nowUs()              { return clockUs; }
+void     sim::advanceUs(uint64_t us) { clockUs += us; pace(); }
+
+void sim::realtime(bool on) {
+  paced    = on;
+  paceUs   = clockUs;
+  paceWall = WallClock::now();
+}
+
+unsigned long millis()             { return (unsigned long)(clockUs / 1000); }
+unsigned long micros()             { return (unsigned long)clockUs; }
+void delay(uint32_t ms)            { clockUs += (uint64_t)ms * 1000; pace(); }
+void delayMicroseconds(uint32_t us) { clockUs += us; pace(); }
+
+uint32_t EspClass::getCycleCount() {
+  return (uint32_t)(clockUs * (F_CPU / 1000000L));
+}
+
+//—————————————————————————————————————————————
+// GPIO
+//—————————————————————————————————————————————
+
+static uint8_t  pinLevels[SIM_PINS];
+static uint8_t  pinModes[SIM_PINS];
+static uint32_t pinRises[SIM_PINS];
+static void   (*pinIsr[SIM_PINS])();
+static int      pinIsrMode[SIM_PINS];
+static void   (*pinHook)(int, int, uint64_t) = nullptr;
+
+// M5 Basic front buttons sit on external pull-ups
+static struct PullUps {
+  PullUps() { pinLevels[37] = pinLevels[38] = pinLevels[39] = HIGH; }
+} pullUps;
+
+// Value Change Dump of selected pins
+static FILE    *vcdFile = nullptr;
+static char     vcdId[SIM_PINS];       // 0 = pin not traced
+static uint64_t vcdLastUs = UINT64_MAX;
+
+static void vcdChange(int pin, int level) {
+  if (vcdLastUs != clockUs) {
+    fprintf(vcdFile, "#%llu\n", (unsigned long long)clockUs);
+    vcdLastUs = clockUs;
+  }
+  fprintf(vcdFile, "%d%c\n", level, vcdId[pin]);
+}
+
+bool sim::vcdOpen(const char *path, const VcdSignal *signals, int count) {
+  vcdClose();
+  vcdFile = fopen(path, "w");
+  if (!vcdFile) return false;
+  fprintf(vcdFile, "$version robocan native sim $end\n$timescale 1us $end\n"
+                   "$scope module robocan $end\n");
+  for (int i = 0; i < count; i++) {
+    int pin = signals[i].pin;
+    if (pin < 0 || pin >= SIM_PINS || vcdId[pin]) continue;
+    vcdId[pin] = (char)('!' + i);
+    fprintf(vcdFile, "$var wire 1 %c %s $end\n", vcdId[pin], signals[i].name);
+  }
+  fprintf(vcdFile, "$upscope $end\n$enddefinitions $end\n#%llu\n$dumpvars\n",
+          (unsigned long long)clockUs);
+  for (int pin = 0; pin < SIM_PINS; pin++) {
+    if (vcdId[pin]) fprintf(vcdFile, "%d%c\n", pinLevels[pin], vcdId[pin]);
+  }
+  fprintf(vcdFile, "$end\n");
+  vcdLastUs = clockUs;
+  return true;
+}
+
+void sim::vcdClose() {
+  if (vcdFile) {
+    fprintf(vcdFile, "#%llu\n", (unsigned long long)clockUs);   // run length
+    fclose(vcdFile);
+  }
+  vcdFile = nullptr;
+  memset(vcdId, 0, sizeof(vcdId));
+}
+
+static void drivePin(int pin, int level) {
+  if (pin < 0 || pin >= SIM_PINS) return;
+  level = level ? HIGH : LOW;
+  if (pinLevels[pin] == level) return;
+  pinLevels[pin] = level;
+  if (level) pinRises[pin]++;
+  if (vcdFile && vcdId[pin]) vcdChange(pin, level);
+  if (pinHook) pinHook(pin, level, clockUs);
+  int m = pinIsrMode[pin];
+  if (pinIsr[pin] && (m == CHANGE || (m == RISING) == (level == HIGH))) pinIsr[pin]();
+}
+
+void pinMode(uint8_t pin, uint8_t mode) { if (pin < SIM_PINS) pinModes[pin] = mode; }
+void digitalWrite(uint8_t pin, uint8_t val) { drivePin(pin, val); }
+int  digitalRead(uint8_t pin) { return pin < SIM_PINS ? pinLevels[pin] : LOW; }
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+  if (pin >= SIM_PINS) return;
+  pinIsr[pin]     = isr;
+  pinIsrMode[pin] = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (pin < SIM_PINS) pinIsr[pin] = nullptr;
+}
+
+SimGpioSet &SimGpioSet::operator=(uint32_t mask) {
+  for (int pin = 0; pin < 32; pin++) if (mask & (1UL << pin)) drivePin(pin, HIGH);
+  return *this;
+}
+
+SimGpioClear &SimGpioClear::operator=(uint32_t mask) {
+  for (int pin = 0; pin < 32; pin++) if (mask & (1UL << pin)) drivePin(pin, LOW);
+  return *this;
+}
+
+int      sim::pinLevel(int pin)    { return pin >= 0 && pin < SIM_PINS ? pinLevels[pin] : LOW; }
+int      sim::pinMode(int pin)     { return pin >= 0 && pin < SIM_PINS ? pinModes[pin] : 0; }
+uint32_t sim::risingEdges(int pin) { return pin >= 0 && pin < SIM_PINS ? pinRises[pin] : 0; }
+void     sim::setInput(int pin, int level) { drivePin(pin, level); }
+void     sim::setPinHook(void (*hook)(int, int, uint64_t)) { pinHook = hook; }
+
+//—————————————————————————————————————————————
+// Controller
+//—————————————————————————————————————————————
+
+static bool padUp = false;
+static void (*padHook)(uint64_t) = nullptr;
+
+XboxControllerNotificationParser &sim::pad() {
+  static XboxControllerNotificationParser p = {};
+  return p;
+}
+
+void sim::setConnected(bool up)                  { padUp = up; }
+bool sim::connected()                            { return padUp; }
+void sim::setPadHook(void (*hook)(uint64_t))     { padHook = hook; }
+
+namespace XboxSeriesXControllerESP32_asukiaaa {
+
+Core::Core() : xboxNotif(sim::pad()) {}
+
+void Core::onLoop() {
+  if (padHook) padHook(clockUs);
+}
+
+bool Core::isConnected() { return padUp; }
+
+}  // namespace XboxSeriesXControllerESP32_asukiaaa
+
+//—————————————————————————————————————————————
+// NVS
+//—————————————————————————————————————————————
+
+typedef std::vector<uint8_t>                      Blob;
+typedef std::map<std::string, std::map<std::string, Blob>> Flash;
+
+static Flash    flash;
+static uint32_t flashWrites = 0;
+static uint32_t flashBytes  = 0;
+
+void     sim::nvsReset()        { flash.clear(); flashWrites = flashBytes = 0; }
+uint32_t sim::nvsWrites()       { return flashWrites; }
+uint32_t sim::nvsBytesWritten() { return flashBytes; }
+
+// file: repeated [ns\0][key\0][u32 length][bytes]
+bool sim::nvsSave(const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (!f) return false;
+  for (const auto &ns : flash) {
+    for (const auto &kv : ns.second) {
+      uint32_t n = (uint32_t)kv.second.size();
+      fwrite(ns.first.c_str(), 1, ns.first.size() + 1, f);
+      fwrite(kv.first.c_str(), 1, kv.first.size() + 1, f);
+      fwrite(&n, sizeof(n), 1, f);
+      if (n) fwrite(kv.second.data(), 1, n, f);
+    }
+  }
+  return fclose(f) == 0;
+}
+
+static bool readString(FILE *f, std::string &s) {
+  s.clear();
+  for (int c; (c = fgetc(f)) != EOF; ) {
+    if (!c) return true;
+    s += (char)c;
+  }
+  return false;
+}
+
+bool sim::nvsLoad(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  flash.clear();
+  std::string ns, key;
+  uint32_t    n;
+  while (readString(f, ns) && readString(f, key) && fread(&n, sizeof(n), 1, f) == 1) {
+    Blob b(n);
+    if (n && fread(b.data(), 1, n, f) != n) break;
+    flash[ns][key] = b;
+  }
+  fclose(f);
+  return true;
+}
+
+bool Preferences::begin(const char *name, bool readOnly) {
+  if (!name || strlen(name) > 15) return false;
+  strcpy(ns_, name);
+  open_     = true;
+  readOnly_ = readOnly;
+  return true;
+}
+
+void Preferences::end() { open_ = false; }
+
+bool Preferences::clear() {
+  if (!open_ || readOnly_) return false;
+  if (flash.erase(ns_)) flashWrites++;
+  return true;
+}
+
+bool Preferences::remove(const char *key) {
+  if (!open_ || readOnly_) return false;
+  if (!flash[ns_].erase(key)) return false;
+  flashWrites++;
+  return true;
+}
+
+bool Preferences::isKey(const char *key) {
+  return open_ && flash.count(ns_) && flash[ns_].count(key);
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+  if (!open_ || readOnly_ || !key) return 0;
+  const uint8_t *p = (const uint8_t *)value;
+  Blob b(p, p + len);
+  Blob &slot = flash[ns_][key];
+  if (slot != b) {                        // NVS skips identical rewrites
+    slot = b;
+    flashWrites++;
+    flashBytes += (uint32_t)len;
+  }
+  return len;
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+  return isKey(key) ? flash[ns_][key].size() : 0;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+  if (!isKey(key)) return 0;
+  const Blob &b = flash[ns_][key];
+  if (b.size() > maxLen) return 0;
+  memcpy(buf, b.data(), b.size());
+  return b.size();
+}
+
+template <class T>
+static T getScalar(Preferences &p, const char *key, T def) {
+  T v;
+  return p.getBytesLength(key) == sizeof(T) && p.getBytes(key, &v, sizeof(T)) ? v : def;
+}
+
+size_t   Preferences::putUChar(const char *key, uint8_t v)  { return putBytes(key, &v, sizeof(v)); }
+size_t   Preferences::putUShort(const char *key, uint16_t v) { return putBytes(key, &v, sizeof(v)); }
+size_t   Preferences::putUInt(const char *key, uint32_t v)  { return putBytes(key, &v, sizeof(v)); }
+uint8_t  Preferences::getUChar(const char *key, uint8_t d)   { return getScalar(*this, key, d); }
+uint16_t Preferences::getUShort(const char *key, uint16_t d) { return getScalar(*this, key, d); }
+uint32_t Preferences::getUInt(const char *key, uint32_t d)   { return getScalar(*this, key, d); }
+
+//—————————————————————————————————————————————
+// Serial
+//—————————————————————————————————————————————
+
+static std::deque<char> serialIn;
+static bool             serialOn = true;
+static FILE            *serialFile = nullptr;
+static int              ptyFd = -1;         // master side, when the port is a pty
+static int              ptySlaveFd = -1;    // kept open: no EIO between host sessions
+
+void sim::serialInput(const char *text) { while (*text) serialIn.push_back(*text++); }
+void sim::serialEcho(bool on)           { serialOn = on; }
+
+bool sim::serialTap(const char *path) {
+  if (serialFile) fclose(serialFile);
+  serialFile = path ? fopen(path, "wb") : nullptr;
+  return serialFile != nullptr;
+}
+
+const char *sim::serialPty() {
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (fd < 0) return nullptr;
+  const char *name = grantpt(fd) || unlockpt(fd) ? nullptr : ptsname(fd);
+  int slave = name ? open(name, O_RDWR | O_NOCTTY) : -1;
+  if (slave < 0) {
+    close(fd);
+    return nullptr;
+  }
+  // raw from the start: no echo or line editing of binary frames
+  termios t;
+  tcgetattr(slave, &t);
+  cfmakeraw(&t);
+  tcsetattr(slave, TCSANOW, &t);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  ptyFd      = fd;
+  ptySlaveFd = slave;
+  return name;
+}
+
+// pty output the host is not reading is dropped, like a UART nobody listens to
+static void ptyWrite(const uint8_t *buf, size_t n) {
+  if (ptyFd < 0) return;
+  ssize_t r = write(ptyFd, buf, n);
+  (void)r;
+}
+
+void HardwareSerial::begin(unsigned long) {}
+
+int HardwareSerial::available() {
+  if (ptyFd >= 0) {
+    char    buf[256];
+    ssize_t n;
+    while ((n = ::read(ptyFd, buf, sizeof(buf))) > 0) serialIn.insert(serialIn.end(), buf, buf + n);
+  }
+  return (int)serialIn.size();
+}
+
+int  HardwareSerial::availableForWrite() { return 128; }
+
+int HardwareSerial::read() {
+  if (serialIn.empty()) return -1;
+  int c = (uint8_t)serialIn.front();
+  serialIn.pop_front();
+  return c;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (serialOn)   fputc(c, stdout);
+  if (serialFile) fputc(c, serialFile);
+  ptyWrite(&c, 1);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t n) {
+  if (serialOn)   fwrite(buf, 1, n, stdout);
+  if (serialFile) fwrite(buf, 1, n, serialFile);
+  ptyWrite(buf, n);
+  return n;
+}
+
+size_t HardwareSerial::print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+
+size_t HardwareSerial::println(const char *s) {
+  size_t n = print(s);
+  return n + write('\n');
+}
+
+size_t HardwareSerial::printf(const char *fmt, ...) {
+  char    buf[256];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  if (n < 0) return 0;
+  return write((const uint8_t *)buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+}
@@ -0,0 +1,73 @@
+// src/sim/sim.h
+
+#pragma once
+
+#include <stdint.h>
+
+#include "robot_config.h"
+
+//—————————————————————————————————————————————
+// Native Simulator
+//
+// Stands in for the M5Stack under the native env: a virtual clock that
+// only moves when the firmware waits (so runs go far faster than real
+// time, unless held to the wall clock for a host), GPIO levels with edge counts and interrupts, an in-memory NVS,
+// Serial on stdio and a scriptable controller. The firmware is built
+// unchanged against the shim headers next to this file.
+//—————————————————————————————————————————————
+
+class XboxControllerNotificationParser;
+
+namespace sim {
+
+#define SIM_PINS  40
+
+// clock
+uint64_t nowUs();
+void     advanceUs(uint64_t us);
+void     realtime(bool on);               // hold the clock to wall time (host on the pty)
+
+// GPIO
+int      pinLevel(int pin);
+int      pinMode(int pin);
+uint32_t risingEdges(int pin);
+void     setInput(int pin, int level);    // drive an input; fires interrupts
+void     setPinHook(void (*hook)(int pin, int level, uint64_t nowUs));   // every level change
+
+// waveform capture: every level change of the given pins, with names,
+// as a Value Change Dump (1 µs timescale) until vcdClose()
+struct VcdSignal {
+  int         pin;
+  const char *name;
+};
+bool     vcdOpen(const char *path, const VcdSignal *signals, int count);
+void     vcdClose();
+
+// driver pins (robot_config.h)
+constexpr VcdSignal MOTOR_SIGNALS[] = {
+  { STEP1_PIN, "STEP1" }, { DIR1_PIN, "DIR1" }, { ENABLE1_PIN, "ENABLE1" },
+  { STEP2_PIN, "STEP2" }, { DIR2_PIN, "DIR2" }, { ENABLE2_PIN, "ENABLE2" },
+};
+constexpr int MOTOR_SIGNAL_COUNT = sizeof(MOTOR_SIGNALS) / sizeof(MOTOR_SIGNALS[0]);
+
+// controller: state the firmware reads, link flag, and a hook called from
+// every Core::onLoop() so a script can change the state on time
+XboxControllerNotificationParser &pad();
+void     setConnected(bool up);
+bool     connected();
+void     setPadHook(void (*hook)(uint64_t nowUs));
+
+// NVS
+void     nvsReset();
+bool     nvsLoad(const char *path);
+bool     nvsSave(const char *path);
+uint32_t nvsWrites();                     // put*/clear calls that changed flash
+uint32_t nvsBytesWritten();
+
+// Serial
+void     serialInput(const char *text);   // queue bytes for Serial.read()
+void     serialEcho(bool on);             // firmware output to stdout
+bool     serialTap(const char *path);     // also copy every byte written to a file
+const char *serialPty();                  // serve the port on a new pty; its slave path
+
+}  // namespace sim
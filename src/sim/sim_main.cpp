@@ -0,0 +1,445 @@
+// src/sim/sim_main.cpp
+//
+// Runs the firmware's setup()/loop() against the simulator with a
+// scripted controller session, then prints a key=value summary for
+// regression checks (exit status 1 if a scripted expectation failed):
+//
+//   .pio/build/native/program [-q] [-t seconds] [--nvs file] [--script name]
+//                             [--trace-out file | --replay file] [--vcd file]
+//                             [--telemetry hz] [--serial-out file] [--pty]
+//   .pio/build/native/program bench [...]      (bench_playback.cpp)
+//   .pio/build/native/program gcode-bench [...] (bench_gcode.cpp)
+//   .pio/build/native/program sched-bench [...] (bench_sched.cpp)
+//   .pio/build/native/program check [...]       (check_motion.cpp)
+//
+// -q hides the firmware's Serial output, --nvs loads flash from the file
+// before the run and writes it back afterwards. --script picks the
+// controller script: session (the default) or linkdrop. --trace-out
+// saves the firmware's input trace (as the T command prints it) at the
+// end; --replay runs a saved or device-exported trace from boot instead
+// of the script. --vcd writes STEP/DIR/ENABLE of both drivers as a Value
+// Change Dump for a waveform viewer. --telemetry starts the binary
+// telemetry stream at that rate (as the M command would); --serial-out
+// copies everything the firmware writes to Serial, frames included, to a
+// file for tools/telemetry_decode.py. --pty serves Serial on a new
+// pseudo-terminal (path on the first stdout line) instead of the script,
+// with the clock held to real time, for a host such as
+// tools/robocan_link.py; -t 0 then runs until SIGINT/SIGTERM, which end
+// the run with the usual summary.
+
+#include "sim.h"
+#include "crc32.h"
+#include "deferred_log.h"
+#include "input_trace.h"
+#include "robot_config.h"
+#include "telemetry.h"
+
+#include <Arduino.h>
+#include <M5Unified.h>
+#include <XboxSeriesXControllerESP32_asukiaaa.hpp>
+
+#include <chrono>
+#include <signal.h>
+#include <stdio.h>
+
+void setup();
+void loop();
+int  benchPlayback(int argc, char **argv);
+int  benchGcode(int argc, char **argv);
+int  benchSched(int argc, char **argv);
+int  checkMotion(int argc, char **argv);
+
+extern InputTrace      inputTrace;
+extern DeferredLog     dlog;
+extern MotionTelemetry telemetry;
+void writeLogLine(const char *line, size_t len);
+
+typedef XboxControllerNotificationParser Pad;
+
+
+//—————————————————————————————————————————————
+// Script
+//—————————————————————————————————————————————
+
+enum CueKind : uint8_t {
+  CUE_PRESS, CUE_RELEASE, CUE_AXIS, CUE_LINK, CUE_PIN, CUE_MARK, CUE_NOTE, CUE_EXPECT,
+};
+
+// what checks compare: step counts and LCD redraws, kept by NOTE cues
+struct Probe {
+  uint32_t step1, step2;
+  uint32_t frames;
+};
+typedef bool (*Check)();
+
+struct Cue {
+  uint32_t       atMs;
+  CueKind        kind;
+  bool Pad::*    btn;
+  uint16_t Pad::*axis;
+  int32_t        value;                   // axis value, link state, pin level, note slot
+  const char    *label;                   // MARK, EXPECT: name in the summary
+  Check          check;                   // EXPECT: true if it holds
+};
+
+static Cue press(uint32_t ms, bool Pad::*b)   { return { ms, CUE_PRESS, b, nullptr, 0, nullptr }; }
+static Cue release(uint32_t ms, bool Pad::*b) { return { ms, CUE_RELEASE, b, nullptr, 0, nullptr }; }
+static Cue axis(uint32_t ms, uint16_t Pad::*a, uint16_t v) { return { ms, CUE_AXIS, nullptr, a, v, nullptr }; }
+static Cue padLink(uint32_t ms, bool up)      { return { ms, CUE_LINK, nullptr, nullptr, up, nullptr }; }
+static Cue pin(uint32_t ms, int p, int level) { return { ms, CUE_PIN, nullptr, nullptr, (p << 1) | level, nullptr }; }
+static Cue mark(uint32_t ms, const char *l)   { return { ms, CUE_MARK, nullptr, nullptr, 0, l }; }
+static Cue note(uint32_t ms, uint8_t slot)    { return { ms, CUE_NOTE, nullptr, nullptr, slot, nullptr }; }
+static Cue expect(uint32_t ms, const char *l, Check c) {
+  return { ms, CUE_EXPECT, nullptr, nullptr, 0, l, c };
+}
+
+static const uint8_t NOTE_SLOTS = 4;
+static Probe         notes[NOTE_SLOTS];
+
+static Probe probe() {
+  return { sim::risingEdges(STEP1_PIN), sim::risingEdges(STEP2_PIN), M5.Lcd.frames };
+}
+
+static const uint16_t STICK_C = 0x8000, STICK_MAX = 0xffff;
+
+// the status screen keeps its DISPLAY_REFRESH_US cadence (200 ms) when
+// idle and under live drive, not only while something waits long enough
+static bool refreshedSince0() { return M5.Lcd.frames - notes[0].frames >= 3; }
+static bool refreshedSince1() { return M5.Lcd.frames - notes[1].frames >= 8; }
+
+// cues in time order: record a short drive, save, reload, play it
+// forward, retrace it, return to the path start, then hit the e-stop
+static const Cue SESSION[] = {
+  padLink(0, true),
+  axis(0, &Pad::joyLVert, STICK_C), axis(0, &Pad::joyRHori, STICK_C),
+  note(1000, 0), expect(1900, "display_idle", refreshedSince0),
+  press(2000, &Pad::btnLB), release(2100, &Pad::btnLB),        // record
+  axis(2500, &Pad::joyLVert, STICK_MAX),                        // forward
+  note(2600, 1), expect(4400, "display_drive", refreshedSince1),
+  axis(4500, &Pad::joyLVert, STICK_C),
+  axis(5000, &Pad::joyRHori, STICK_MAX),                        // spin
+  axis(6000, &Pad::joyRHori, STICK_C),
+  axis(6500, &Pad::joyLVert, 0),                                // back
+  axis(7500, &Pad::joyLVert, STICK_C),
+  press(8000, &Pad::btnLB), release(8100, &Pad::btnLB),        // stop
+  mark(8500, "recorded"),
+  press(9000, &Pad::btnSelect), release(9100, &Pad::btnSelect), // save
+  press(9500, &Pad::btnStart), release(9600, &Pad::btnStart),   // load
+  mark(9900, "before_play"),
+  press(10000, &Pad::btnA), release(10100, &Pad::btnA),        // play
+  mark(19900, "after_play"),
+  press(20000, &Pad::btnB), release(20100, &Pad::btnB),        // retrace
+  mark(29900, "after_retrace"),
+  press(30000, &Pad::btnDirDown), release(30100, &Pad::btnDirDown),
+  mark(39900, "after_return"),
+  pin(39950, ESTOP_PIN, LOW), pin(39960, ESTOP_PIN, HIGH),                   // BtnC e-stop
+};
+
+// link drop mid-playback (--script linkdrop): the run winds down within
+// a stop from the recorded rate, the screen shows where it paused and
+// that is exactly the steps output; reconnecting alone moves nothing, A
+// finishes the run to the recorded totals. A second drop is discarded
+// with X, after which A plays the whole recording again.
+//
+// The drive is recorded at full stick, 80 mm/s: about 408 steps/s on a
+// 100 mm wheel at 1600 steps/rev. Stopping from there at
+// MAX_ACCEL_STEPS_S2 takes v²/2a steps, plus one 10 ms input poll before
+// the drop is seen.
+static const uint32_t DRIVE_RATE    = 408;
+static const uint32_t WIND_DOWN_MAX = DRIVE_RATE * DRIVE_RATE / (2 * MAX_ACCEL_STEPS_S2) +
+                                      DRIVE_RATE / 100 + 1;
+enum : uint8_t { NOTE_RECORDED, NOTE_DROP, NOTE_STOPPED };
+
+static Probe since(uint8_t slot) {
+  Probe p = probe();
+  return { p.step1 - notes[slot].step1, p.step2 - notes[slot].step2,
+           p.frames - notes[slot].frames };
+}
+
+// the PAUSED line of the status screen: false if it is not up
+static bool pausedShown(unsigned &segment, unsigned long &steps) {
+  const char *p = strstr(M5.Lcd.text, "PAUSED #");
+  return p && sscanf(p, "PAUSED #%u +%lu", &segment, &steps) == 2;
+}
+
+static bool woundDown() {
+  Probe d = since(NOTE_DROP);
+  return notes[NOTE_DROP].step1 > notes[NOTE_RECORDED].step1 &&   // it was moving
+         d.step1 <= WIND_DOWN_MAX && d.step2 <= WIND_DOWN_MAX;
+}
+
+// stopped in the first segment, a straight run: the snapshot's offset
+// is every step played
+static bool pausedExactly() {
+  unsigned      segment;
+  unsigned long steps;
+  Probe         d = since(NOTE_STOPPED);
+  return !d.step1 && !d.step2 && pausedShown(segment, steps) && segment == 0 &&
+         steps == probe().step1 - notes[NOTE_RECORDED].step1 &&
+         steps == probe().step2 - notes[NOTE_RECORDED].step2;
+}
+
+static bool stillPaused() {
+  unsigned      segment;
+  unsigned long steps;
+  Probe         d = since(NOTE_STOPPED);
+  return !d.step1 && !d.step2 && pausedShown(segment, steps) &&
+         strstr(M5.Lcd.text, "PLAY:OFF");
+}
+
+// every recorded step played once since the recording
+static bool resumedToEnd() {
+  unsigned      segment;
+  unsigned long steps;
+  Probe         d = since(NOTE_RECORDED);
+  return d.step1 == notes[NOTE_RECORDED].step1 && d.step2 == notes[NOTE_RECORDED].step2 &&
+         !pausedShown(segment, steps);
+}
+
+static bool discarded() {
+  unsigned      segment;
+  unsigned long steps;
+  Probe         d = since(NOTE_STOPPED);
+  return !d.step1 && !d.step2 && !pausedShown(segment, steps);
+}
+
+// a fresh run after the discard: the whole recording again
+static bool playedFresh() {
+  Probe d = since(NOTE_STOPPED);
+  return d.step1 == notes[NOTE_RECORDED].step1 && d.step2 == notes[NOTE_RECORDED].step2;
+}
+
+static const Cue LINKDROP[] = {
+  padLink(0, true),
+  axis(0, &Pad::joyLVert, STICK_C), axis(0, &Pad::joyRHori, STICK_C),
+  press(2000, &Pad::btnLB), release(2100, &Pad::btnLB),        // record
+  axis(2500, &Pad::joyLVert, STICK_MAX),                        // forward
+  axis(4500, &Pad::joyLVert, STICK_C),
+  axis(5000, &Pad::joyRHori, STICK_MAX),                        // spin
+  axis(6000, &Pad::joyRHori, STICK_C),
+  axis(6500, &Pad::joyLVert, 0),                                // back
+  axis(7500, &Pad::joyLVert, STICK_C),
+  press(8000, &Pad::btnLB), release(8100, &Pad::btnLB),        // stop
+  note(8500, NOTE_RECORDED),
+  press(9000, &Pad::btnA), release(9100, &Pad::btnA),          // play
+  padLink(9900, false), note(9900, NOTE_DROP),                  // drop
+  expect(10900, "wind_down", woundDown),
+  note(10900, NOTE_STOPPED),
+  expect(11400, "paused_at", pausedExactly),
+  padLink(12000, true),                                         // reconnect
+  expect(14000, "no_restart", stillPaused),
+  press(14500, &Pad::btnA), release(14600, &Pad::btnA),        // resume
+  expect(24000, "resumed", resumedToEnd),
+  press(24500, &Pad::btnA), release(24600, &Pad::btnA),        // again
+  padLink(25400, false),
+  note(26400, NOTE_STOPPED),
+  padLink(26500, true),
+  expect(27900, "paused_again", stillPaused),
+  press(28000, &Pad::btnX), release(28100, &Pad::btnX),        // discard
+  expect(28500, "discarded", discarded),
+  press(29000, &Pad::btnA), release(29100, &Pad::btnA),        // play anew
+  expect(38000, "played_fresh", playedFresh),
+};
+
+struct Script {
+  const char *name;
+  const Cue  *cues;
+  size_t      count;
+};
+
+static const Script SCRIPTS[] = {
+  { "session",  SESSION,  sizeof(SESSION) / sizeof(SESSION[0]) },
+  { "linkdrop", LINKDROP, sizeof(LINKDROP) / sizeof(LINKDROP[0]) },
+};
+
+static const Script *script = &SCRIPTS[0];
+static size_t nextCue = 0;
+static bool   failed  = false;            // an EXPECT cue did not hold
+
+static void printMark(const char *label) {
+  printf("SIM mark=%s t_ms=%llu step1=%lu step2=%lu\n", label,
+         (unsigned long long)(sim::nowUs() / 1000),
+         (unsigned long)sim::risingEdges(STEP1_PIN), (unsigned long)sim::risingEdges(STEP2_PIN));
+}
+
+static void expectCue(const Cue &c) {
+  bool ok = c.check();
+  failed |= !ok;
+  printf("SIM expect=%s ok=%d t_ms=%llu step1=%lu step2=%lu frames=%lu\n", c.label, ok,
+         (unsigned long long)(sim::nowUs() / 1000), (unsigned long)sim::risingEdges(STEP1_PIN),
+         (unsigned long)sim::risingEdges(STEP2_PIN), (unsigned long)M5.Lcd.frames);
+}
+
+// applied from Core::onLoop(), i.e. whenever the firmware polls input
+static void applyCues(uint64_t nowUs) {
+  Pad &p = sim::pad();
+  while (nextCue < script->count && (uint64_t)script->cues[nextCue].atMs * 1000 <= nowUs) {
+    const Cue &c = script->cues[nextCue++];
+    switch (c.kind) {
+      case CUE_PRESS:   p.*c.btn  = true;               break;
+      case CUE_RELEASE: p.*c.btn  = false;              break;
+      case CUE_AXIS:    p.*c.axis = (uint16_t)c.value;  break;
+      case CUE_LINK:    sim::setConnected(c.value);     break;
+      case CUE_PIN:     sim::setInput(c.value >> 1, c.value & 1); break;
+      case CUE_MARK:    printMark(c.label);             break;
+      case CUE_NOTE:    notes[c.value] = probe();       break;
+      case CUE_EXPECT:  expectCue(c);                   break;
+    }
+  }
+}
+
+//—————————————————————————————————————————————
+// Input Traces
+//—————————————————————————————————————————————
+
+static void traceLine(const char *line, void *f) { fprintf((FILE *)f, "%s\n", line); }
+
+static bool saveTrace(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f) return false;
+  writeInputTrace(inputTrace, (uint32_t)sim::nowUs(), traceLine, f);
+  return fclose(f) == 0;
+}
+
+// reads the I lines of a trace (other lines, e.g. the rest of a serial
+// log, are skipped), checks all of them against the END line's CRC and
+// loads them into t; name is for the messages. Also used by check.
+bool readInputTrace(FILE *f, InputTrace &t, const char *name) {
+  static InputSample samples[INPUT_TRACE_SLOTS];
+  InputSample   s;
+  char          line[128];
+  uint32_t      n = 0, crc = 0;
+  unsigned long want;
+  bool          checked = false, ok = true;
+  while (fgets(line, sizeof(line), f)) {
+    line[strcspn(line, "\r\n")] = 0;
+    if (sscanf(line, "TRACE END crc=%lx", &want) == 1) {
+      checked = true;
+      ok      = want == crc;
+      break;
+    }
+    if (parseInputSample(line, s)) {
+      crc = crc32Update(crc, line, strlen(line));
+      if (n < INPUT_TRACE_SLOTS) samples[n] = s;
+      n++;
+    }
+  }
+  if (!ok) {
+    fprintf(stderr, "%s: CRC mismatch\n", name);
+    return false;
+  }
+  if (n > INPUT_TRACE_SLOTS) {
+    fprintf(stderr, "%s: %lu samples, at most %u fit\n", name, (unsigned long)n,
+            (unsigned)INPUT_TRACE_SLOTS);
+    return false;
+  }
+  if (!checked) fprintf(stderr, "%s: no TRACE END line, CRC not checked\n", name);
+  t.load(samples, n);
+  return true;
+}
+
+static bool loadTrace(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) return false;
+  bool ok = readInputTrace(f, inputTrace, path);
+  fclose(f);
+  return ok;
+}
+
+//—————————————————————————————————————————————
+// Main
+//—————————————————————————————————————————————
+
+static volatile sig_atomic_t stopRun = 0;
+
+static void onSignal(int) { stopRun = 1; }
+
+int main(int argc, char **argv) {
+  if (argc > 1 && !strcmp(argv[1], "bench")) return benchPlayback(argc - 1, argv + 1);
+  if (argc > 1 && !strcmp(argv[1], "gcode-bench")) return benchGcode(argc - 1, argv + 1);
+  if (argc > 1 && !strcmp(argv[1], "sched-bench")) return benchSched(argc - 1, argv + 1);
+  if (argc > 1 && !strcmp(argv[1], "check")) return checkMotion(argc - 1, argv + 1);
+
+  double      seconds = 40.0;
+  const char *nvsPath = nullptr;
+  const char *traceOut = nullptr, *replayPath = nullptr, *vcdPath = nullptr;
+  const char *serialOut = nullptr;
+  uint32_t    telemetryHz = 0;
+  bool        pty = false;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-q"))                      sim::serialEcho(false);
+    else if (!strcmp(argv[i], "-t") && i + 1 < argc) seconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--nvs") && i + 1 < argc) nvsPath = argv[++i];
+    else if (!strcmp(argv[i], "--trace-out") && i + 1 < argc) traceOut = argv[++i];
+    else if (!strcmp(argv[i], "--replay") && i + 1 < argc) replayPath = argv[++i];
+    else if (!strcmp(argv[i], "--vcd") && i + 1 < argc) vcdPath = argv[++i];
+    else if (!strcmp(argv[i], "--telemetry") && i + 1 < argc) telemetryHz = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--serial-out") && i + 1 < argc) serialOut = argv[++i];
+    else if (!strcmp(argv[i], "--pty"))              pty = true;
+    else if (!strcmp(argv[i], "--script") && i + 1 < argc) {
+      const char *name = argv[++i];
+      script = nullptr;
+      for (const Script &sc : SCRIPTS) {
+        if (!strcmp(sc.name, name)) script = &sc;
+      }
+      if (!script) {
+        fprintf(stderr, "%s: no such script\n", name);
+        return 1;
+      }
+    }
+  }
+  if (serialOut && !sim::serialTap(serialOut)) {
+    fprintf(stderr, "%s: cannot write\n", serialOut);
+    return 1;
+  }
+  if (vcdPath && !sim::vcdOpen(vcdPath, sim::MOTOR_SIGNALS, sim::MOTOR_SIGNAL_COUNT)) {
+    fprintf(stderr, "%s: cannot write\n", vcdPath);
+    return 1;
+  }
+  if (nvsPath) sim::nvsLoad(nvsPath);
+  if (pty) {
+    const char *path = sim::serialPty();
+    if (!path) {
+      perror("pty");
+      return 1;
+    }
+    printf("SIM pty=%s\n", path);
+    fflush(stdout);
+    sim::serialEcho(false);
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+  } else if (replayPath) {
+    if (!loadTrace(replayPath)) return 1;
+    inputTrace.startReplay(0);
+  } else {
+    sim::setPadHook(applyCues);
+  }
+
+  auto     wall0 = std::chrono::steady_clock::now();
+  uint64_t endUs = (uint64_t)(seconds * 1e6);
+  uint64_t loops = 0;
+  setup();
+  telemetry.setRate(telemetryHz);
+  sim::realtime(pty);
+  while ((!endUs || sim::nowUs() < endUs) && !stopRun) {
+    loop();
+    loops++;
+  }
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+
+  dlog.drain(writeLogLine);
+  sim::vcdClose();
+  sim::serialTap(nullptr);
+  if (nvsPath) sim::nvsSave(nvsPath);
+  if (traceOut && !saveTrace(traceOut)) fprintf(stderr, "%s: not written\n", traceOut);
+  printf("SIM virtual_s=%.3f wall_s=%.3f speedup=%.0f loops=%llu\n",
+         sim::nowUs() / 1e6, wall, wall > 0 ? sim::nowUs() / 1e6 / wall : 0.0,
+         (unsigned long long)loops);
+  printf("SIM step1=%lu step2=%lu nvs_writes=%lu nvs_bytes=%lu\n",
+         (unsigned long)sim::risingEdges(STEP1_PIN), (unsigned long)sim::risingEdges(STEP2_PIN),
+         (unsigned long)sim::nvsWrites(), (unsigned long)sim::nvsBytesWritten());
+  printf("SIM log_records=%lu log_dropped=%lu log_high_water=%lu\n",
+         (unsigned long)dlog.logged(), (unsigned long)dlog.dropped(),
+         (unsigned long)dlog.highWater());
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,17 @@
+// src/sim/soc/gpio_struct.h
+//
+// Set/clear registers for GPIO 0–31: writing a mask drives those pins.
+
+#pragma once
+
+#include <stdint.h>
+
+struct SimGpioSet   { SimGpioSet   &operator=(uint32_t mask); };
+struct SimGpioClear { SimGpioClear &operator=(uint32_t mask); };
+
+struct gpio_dev_t {
+  SimGpioSet   out_w1ts;
+  SimGpioClear out_w1tc;
+};
+
+extern gpio_dev_t GPIO;
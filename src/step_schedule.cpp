@@ -0,0 +1,181 @@
+// src/step_schedule.cpp
+
+#include "step_schedule.h"
+#include "crc32.h"
+
+#include <string.h>
+
+//—————————————————————————————————————————————
+// Compile
+//—————————————————————————————————————————————
+
+uint32_t segmentsStamp(const Segment *segs, uint16_t count) {
+  uint32_t crc = crc32Update(0, &count, sizeof(count));
+  return crc32Update(crc, segs, sizeof(Segment) * count);
+}
+
+bool scheduleMatches(const StepSchedule &s, const Segment *segs, uint16_t count) {
+  return s.blockCount == count &&
+         s.maskBytes <= SCHEDULE_MASK_BYTES &&
+         s.stamp == segmentsStamp(segs, count);
+}
+
+void compileBlock(ScheduleBlock &b, const Segment &s) {
+  uint32_t p1 = s.pulses1 > 0 ? (uint32_t)s.pulses1 : 0;
+  uint32_t p2 = s.pulses2 > 0 ? (uint32_t)s.pulses2 : 0;
+
+  b.dirBits    = (s.dir1 > 0 ? AXIS1_BIT : 0) | (s.dir2 > 0 ? AXIS2_BIT : 0);
+  b.enableBits = (s.dir1 != 0 ? AXIS1_BIT : 0) | (s.dir2 != 0 ? AXIS2_BIT : 0);
+  b.ticks      = p1 > p2 ? p1 : p2;
+  b.aux        = 0;
+
+  uint64_t totalUs = (uint64_t)s.durationMs * 1000ULL;
+  if (totalUs > UINT32_MAX) totalUs = UINT32_MAX;
+  if (!b.ticks) {
+    b.kind     = BLOCK_UNIFORM;
+    b.mask     = 0;
+    b.periodUs = (uint32_t)totalUs;
+    b.remUs    = 0;
+    return;
+  }
+  b.periodUs = (uint32_t)(totalUs / b.ticks);
+  b.remUs    = (uint32_t)(totalUs % b.ticks);
+
+  if (p1 == p2 || !p1 || !p2) {
+    b.kind = BLOCK_UNIFORM;
+    b.mask = (p1 ? AXIS1_BIT : 0) | (p2 ? AXIS2_BIT : 0);
+    return;
+  }
+
+  // unequal rates: the major axis steps every tick, the minor axis is
+  // spread evenly across them (Bresenham, centred)
+  b.kind = BLOCK_INTERLEAVED;
+  b.mask = p1 > p2 ? AXIS1_BIT : AXIS2_BIT;
+  b.aux  = p1 > p2 ? p2 : p1;
+}
+
+void compileSchedule(StepSchedule &out, const Segment *segs, uint16_t count) {
+  out.stamp      = segmentsStamp(segs, count);
+  out.blockCount = count;
+  out.reserved   = 0;
+  out.maskBytes  = 0;
+
+  for (uint16_t i = 0; i < count; i++) {
+    ScheduleBlock &b = out.blocks[i];
+    compileBlock(b, segs[i]);
+    if (b.kind != BLOCK_INTERLEAVED) continue;
+
+    // precompute the interleave while the arena has room
+    uint8_t  major = b.mask;
+    uint8_t  minor = major ^ AXIS_ALL;
+    uint32_t m     = b.aux;
+    uint32_t bytes = (b.ticks + 3) / 4;
+    if (out.maskBytes + bytes > SCHEDULE_MASK_BYTES) continue;
+
+    b.kind = BLOCK_PACKED;
+    b.aux  = out.maskBytes;
+    uint8_t *dst = out.masks + out.maskBytes;
+    memset(dst, 0, bytes);
+    uint32_t acc = b.ticks / 2;
+    for (uint32_t k = 0; k < b.ticks; k++) {
+      uint8_t bits = major;
+      acc += m;
+      if (acc >= b.ticks) { acc -= b.ticks; bits |= minor; }
+      dst[k >> 2] |= bits << ((k & 3) * 2);
+    }
+    out.maskBytes += bytes;
+  }
+}
+
+//—————————————————————————————————————————————
+// Cursor
+//—————————————————————————————————————————————
+
+void ScheduleCursor::begin(const StepSchedule &s, bool reverse, uint32_t gapUs) {
+  sched_   = &s;
+  reverse_ = reverse;
+  gapUs_   = gapUs;
+  left_    = s.blockCount;
+  idx_     = 0;
+  inBlock_ = false;
+  gapDue_  = false;
+}
+
+bool ScheduleCursor::next(StepTick &t) {
+  if (gapDue_) {
+    gapDue_ = false;
+    if (gapUs_) {
+      t.mask       = 0;
+      t.dirBits    = dirBits_;
+      t.enableBits = blk_->enableBits;
+      t.block      = idx_;
+      t.intervalUs = gapUs_;
+      return true;
+    }
+  }
+
+  if (!inBlock_) {
+    if (!left_) return false;
+    idx_  = reverse_ ? left_ - 1 : sched_->blockCount - left_;
+    blk_  = &sched_->blocks[idx_];
+    left_--;
+    inBlock_ = true;
+    // a retrace runs every block backwards: enabled axes flip direction
+    // and ticks are taken last to first (mirroring interval remainders
+    // and the interleave pattern). The settle gap still trails each
+    // block, so a retrace starts moving at once and takes as long as
+    // the forward run
+    if (reverse_) {
+      dirBits_ = blk_->dirBits ^ blk_->enableBits;
+      tick_    = blk_->ticks;
+      acc_     = blk_->ticks / 2;   // end state of the forward pattern
+      return next(t);
+    }
+    dirBits_ = blk_->dirBits;
+    tick_    = 0;
+    acc_     = blk_->ticks / 2;
+  }
+
+  const ScheduleBlock &b = *blk_;
+  t.dirBits    = dirBits_;
+  t.enableBits = b.enableBits;
+  t.block      = idx_;
+
+  if (!b.ticks) {
+    t.mask       = 0;
+    t.intervalUs = b.periodUs;
+    inBlock_ = false;
+    gapDue_  = true;
+    return true;
+  }
+
+  uint32_t k = reverse_ ? tick_ - 1 : tick_;
+  switch (b.kind) {
+    case BLOCK_PACKED:
+      t.mask = (sched_->masks[b.aux + (k >> 2)] >> ((k & 3) * 2)) & AXIS_ALL;
+      break;
+    case BLOCK_INTERLEAVED:
+      t.mask = b.mask;
+      if (!reverse_) {
+        acc_ += b.aux;
+        if (acc_ >= b.ticks) { acc_ -= b.ticks; t.mask |= b.mask ^ AXIS_ALL; }
+      } else if (acc_ < b.aux) {
+        // undo a forward step: the minor axis fired on this tick
+        acc_ += b.ticks - b.aux;
+        t.mask |= b.mask ^ AXIS_ALL;
+      } else {
+        acc_ -= b.aux;
+      }
+      break;
+    default:
+      t.mask = b.mask;
+      break;
+  }
+  t.intervalUs = b.periodUs + (k < b.remUs ? 1 : 0);
+
+  if (reverse_ ? --tick_ == 0 : ++tick_ >= b.ticks) {
+    inBlock_ = false;
+    gapDue_  = true;
+  }
+  return true;
+}
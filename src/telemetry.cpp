@@ -0,0 +1,108 @@
+// src/telemetry.cpp
+
+#include "telemetry.h"
+
+void MotionTelemetry::step(uint8_t mask, uint32_t nowUs) {
+  for (uint8_t a = 0; a < 2; a++) {
+    if (!(mask & (1 << a))) continue;
+    stepUs_[a]   = nowUs - lastStep_[a];
+    lastStep_[a] = nowUs;
+  }
+}
+
+void MotionTelemetry::tick(uint8_t mask, uint32_t intervalUs) {
+  for (uint8_t a = 0; a < 2; a++) {
+    if (mask & (1 << a)) {
+      // first step after rest: the tick interval is all there is to go on
+      planUs_[a]    = sinceStep_[a] ? sinceStep_[a] : intervalUs;
+      sinceStep_[a] = 0;
+    }
+    sinceStep_[a] += intervalUs;
+  }
+}
+
+void MotionTelemetry::rates(int32_t r1, int32_t r2) {
+  planUs_[0] = r1 ? 1000000UL / (uint32_t)(r1 < 0 ? -r1 : r1) : 0;
+  planUs_[1] = r2 ? 1000000UL / (uint32_t)(r2 < 0 ? -r2 : r2) : 0;
+}
+
+void MotionTelemetry::idle() {
+  planUs_[0] = planUs_[1] = 0;
+  sinceStep_[0] = sinceStep_[1] = 0;
+}
+
+void MotionTelemetry::poll(uint32_t nowUs) {
+  uint32_t gap = nowUs - lastPoll_;
+  if (lastPoll_ && gap > loopMax_) loopMax_ = gap;
+  lastPoll_ = nowUs;
+}
+
+void MotionTelemetry::setRate(uint32_t hz) {
+  hz_       = hz;
+  periodUs_ = hz ? 1000000UL / hz : 0;
+}
+
+bool MotionTelemetry::sample(uint32_t nowUs, TelemetrySample &s) {
+  if (!hz_ || (int32_t)(nowUs - dueUs_) < 0) return false;
+  // fixed cadence; after a stall, restart it rather than send a burst
+  dueUs_ += periodUs_;
+  if ((int32_t)(nowUs - dueUs_) >= 0) dueUs_ = nowUs + periodUs_;
+
+  s.seq = seq_++;
+  s.tUs = nowUs;
+  for (uint8_t a = 0; a < 2; a++) {
+    s.planUs[a]     = planUs_[a];
+    s.stepUs[a]     = stepUs_[a];
+    s.lastStepUs[a] = lastStep_[a];
+  }
+  s.loopUs = loopMax_;
+  loopMax_ = 0;
+  return true;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t v) {
+  for (int b = 0; b < 4; b++) *p++ = (uint8_t)(v >> (8 * b));
+  return p;
+}
+
+static const uint8_t *get32(const uint8_t *p, uint32_t &v) {
+  v = 0;
+  for (int b = 0; b < 4; b++) v |= (uint32_t)*p++ << (8 * b);
+  return p;
+}
+
+size_t packTelemetry(const TelemetrySample &s, uint8_t *out) {
+  uint8_t *p = out;
+  p = put32(p, s.seq);
+  p = put32(p, s.tUs);
+  for (uint8_t a = 0; a < 2; a++) p = put32(p, (uint32_t)s.pos[a]);
+  for (uint8_t a = 0; a < 2; a++) p = put32(p, s.planUs[a]);
+  for (uint8_t a = 0; a < 2; a++) p = put32(p, s.stepUs[a]);
+  for (uint8_t a = 0; a < 2; a++) p = put32(p, s.lastStepUs[a]);
+  p = put32(p, s.loopUs);
+  p = put32(p, (uint32_t)s.feed);
+  *p++ = s.dirBits;
+  *p++ = s.enableBits;
+  *p++ = (uint8_t)s.flags;
+  *p++ = (uint8_t)(s.flags >> 8);
+  return (size_t)(p - out);
+}
+
+bool unpackTelemetry(const uint8_t *in, size_t len, TelemetrySample &s) {
+  if (len != TELEMETRY_SAMPLE_BYTES) return false;
+  const uint8_t *p = in;
+  uint32_t       v;
+  p = get32(p, s.seq);
+  p = get32(p, s.tUs);
+  for (uint8_t a = 0; a < 2; a++) { p = get32(p, v); s.pos[a] = (int32_t)v; }
+  for (uint8_t a = 0; a < 2; a++) p = get32(p, s.planUs[a]);
+  for (uint8_t a = 0; a < 2; a++) p = get32(p, s.stepUs[a]);
+  for (uint8_t a = 0; a < 2; a++) p = get32(p, s.lastStepUs[a]);
+  p = get32(p, s.loopUs);
+  p = get32(p, v);
+  s.feed       = (int32_t)v;
+  s.dirBits    = p[0];
+  s.enableBits = p[1];
+  s.flags      = (uint16_t)(p[2] | (p[3] << 8));
+  return true;
+}
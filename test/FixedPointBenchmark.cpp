@@ -0,0 +1,193 @@
+// test/FixedPointBenchmark.cpp
+//
+// Accuracy and speed of the fixed-point motion math against float.
+// Runs as a sketch on the M5Stack (cycles from the CPU counter) or as a
+// plain program on a host, built from the repo root:
+//
+//   g++ -O2 -std=gnu++17 -Iinclude test/FixedPointBenchmark.cpp
+//       src/fixed_point.cpp src/diff_drive.cpp src/move_planner.cpp -o fpbench
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "diff_drive.h"
+#include "fixed_point.h"
+#include "move_planner.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+typedef uint32_t cyc_t;                 // wraps every ~18 s at 240 MHz
+static inline cyc_t cycles() { return ESP.getCycleCount(); }
+#define OUT(...) Serial.printf(__VA_ARGS__)
+#else
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+typedef uint64_t cyc_t;
+static inline cyc_t cycles() { return __rdtsc(); }
+#else
+typedef uint64_t cyc_t;                 // no cycle counter: nanoseconds
+static inline cyc_t cycles() {
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+#endif
+#define OUT(...) printf(__VA_ARGS__)
+#endif
+
+static const uint32_t N = 20000;
+static volatile int64_t sinkI;
+static volatile float   sinkF;
+
+struct Result {
+  const char *name;
+  float       fixedCyc, floatCyc;
+  double      maxErr;
+  const char *unit;
+};
+
+static void report(const Result &r) {
+  OUT("%-16s fixed %8.1f cyc/op  float %8.1f cyc/op  max err %.4g %s\n",
+      r.name, r.fixedCyc, r.floatCyc, r.maxErr, r.unit);
+}
+
+// ramp step period: 1e6 / sqrt(accel·(2n+1))
+static Result benchRamp() {
+  const uint32_t accel = 4000;
+  double err = 0;
+  for (uint32_t n = 0; n < 500; n++) {
+    double ref = 1e6 / sqrt((double)accel * (2 * n + 1));
+    double e   = fabs(periodUsQ16(sqrtQ16(accel * (2 * n + 1))) - ref);
+    if (e > err) err = e;
+  }
+  cyc_t t0 = cycles();
+  for (uint32_t i = 0; i < N; i++) sinkI = periodUsQ16(sqrtQ16(accel * (2 * (i & 511) + 1)));
+  cyc_t t1 = cycles();
+  for (uint32_t i = 0; i < N; i++) sinkF = 1e6f / sqrtf((float)accel * (2 * (i & 511) + 1));
+  cyc_t t2 = cycles();
+  return { "ramp period", (float)(cyc_t)(t1 - t0) / N, (float)(cyc_t)(t2 - t1) / N, err, "us" };
+}
+
+// the same period as the step loop gets it: RampPeriod walking a ramp
+// up and back down one tick at a time (square roots only where reseeded)
+static Result benchRampWalk() {
+  const uint32_t accel = 4000;
+  RampPeriod rp;
+  rp.begin(accel);
+  double err = 0;
+  for (uint32_t i = 0; i < 1024; i++) {
+    uint32_t n   = i < 512 ? i : 1023 - i;
+    double   ref = 1e6 / sqrt((double)accel * (2 * n + 1));
+    double   e   = fabs(rp.at(n) - ref);
+    if (e > err) err = e;
+  }
+  cyc_t t0 = cycles();
+  for (uint32_t i = 0; i < N; i++) sinkI = rp.at((i & 512) ? 511 - (i & 511) : (i & 511));
+  cyc_t t1 = cycles();
+  for (uint32_t i = 0; i < N; i++) {
+    uint32_t n = (i & 512) ? 511 - (i & 511) : (i & 511);
+    sinkF = 1e6f / sqrtf((float)accel * (2 * n + 1));
+  }
+  cyc_t t2 = cycles();
+  return { "ramp walk", (float)(cyc_t)(t1 - t0) / N, (float)(cyc_t)(t2 - t1) / N, err, "us" };
+}
+
+// feed-override scaling of a tick interval (error relative, factor
+// quantisation included)
+static Result benchScale() {
+  double err = 0;
+  for (uint32_t k = 10; k <= 300; k++) {
+    Q16      f   = Q16::ratio(k, 100);
+    uint32_t us  = 400 + k * 37;
+    double   ref = us / (k / 100.0);
+    double   e   = fabs((double)((((uint64_t)us << 16) + f.raw / 2) / f.raw) - ref) / ref;
+    if (e > err) err = e;
+  }
+  Q16   f  = Q16::ratio(3, 2);
+  float ff = 1.5f;
+  cyc_t t0 = cycles();
+  for (uint32_t i = 0; i < N; i++) sinkI = (((uint64_t)(400 + i) << 16) + f.raw / 2) / f.raw;
+  cyc_t t1 = cycles();
+  for (uint32_t i = 0; i < N; i++) sinkF = (float)(400 + i) / ff;
+  cyc_t t2 = cycles();
+  return { "feed scale", (float)(cyc_t)(t1 - t0) / N, (float)(cyc_t)(t2 - t1) / N, err, "rel" };
+}
+
+// twist → wheel rates
+static Result benchKinematics() {
+  const DiffDrive dd(1600, 100, 150);
+  const float stepsPerMm = 1600.0f / (float)(M_PI * 100.0), half = 75.0f;
+  double err = 0;
+  for (int32_t v = -200; v <= 200; v += 10) {
+    for (int32_t w = -2000; w <= 2000; w += 100) {
+      WheelRates r = dd.toWheels({ v, w });
+      double ref = (v - w * 0.075) * 1600.0 / (M_PI * 100.0);
+      double e   = fabs(r.left - ref);
+      if (e > err) err = e;
+    }
+  }
+  cyc_t t0 = cycles();
+  for (uint32_t i = 0; i < N; i++) sinkI = dd.toWheels({ (int32_t)(i & 255), (int32_t)(i & 1023) }).left;
+  cyc_t t1 = cycles();
+  for (uint32_t i = 0; i < N; i++) {
+    sinkF = ((float)(i & 255) - (float)(i & 1023) * half / 1000.0f) * stepsPerMm;
+  }
+  cyc_t t2 = cycles();
+  return { "twist->wheels", (float)(cyc_t)(t1 - t0) / N, (float)(cyc_t)(t2 - t1) / N, err, "steps/s" };
+}
+
+// sine for odometry
+static Result benchSin() {
+  double err = 0;
+  for (uint32_t k = 0; k < 4096; k++) {
+    uint32_t bam = k << 20;
+    double   e   = fabs(sinQ15(bam) / 32768.0 - sin(bam * (2 * M_PI / 4294967296.0)));
+    if (e > err) err = e;
+  }
+  cyc_t t0 = cycles();
+  for (uint32_t i = 0; i < N; i++) sinkI = sinQ15(i * 214748u);
+  cyc_t t1 = cycles();
+  for (uint32_t i = 0; i < N; i++) sinkF = sinf((float)i * 3.1416e-4f);
+  cyc_t t2 = cycles();
+  return { "sin", (float)(cyc_t)(t1 - t0) / N, (float)(cyc_t)(t2 - t1) / N, err, "" };
+}
+
+// plain square root, Q16 result
+static Result benchSqrt() {
+  double err = 0;
+  for (uint32_t x = 1; x < 1u << 24; x = x * 3 / 2 + 1) {
+    double e = fabs(sqrtQ16(x).raw / 65536.0 - sqrt((double)x));
+    if (e > err) err = e;
+  }
+  cyc_t t0 = cycles();
+  for (uint32_t i = 0; i < N; i++) sinkI = sqrtQ16(i * 97 + 1).raw;
+  cyc_t t1 = cycles();
+  for (uint32_t i = 0; i < N; i++) sinkF = sqrtf((float)(i * 97 + 1));
+  cyc_t t2 = cycles();
+  return { "sqrt", (float)(cyc_t)(t1 - t0) / N, (float)(cyc_t)(t2 - t1) / N, err, "" };
+}
+
+static void runAll() {
+  OUT("fixed-point vs float, %lu iterations each\n", (unsigned long)N);
+  report(benchRamp());
+  report(benchRampWalk());
+  report(benchScale());
+  report(benchKinematics());
+  report(benchSin());
+  report(benchSqrt());
+}
+
+#ifdef ARDUINO
+void setup() {
+  Serial.begin(115200);
+  delay(500);
+  runAll();
+}
+
+void loop() {}
+#else
+int main() {
+  runAll();
+  return 0;
+}
+#endif
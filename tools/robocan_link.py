@@ -0,0 +1,529 @@
+#!/usr/bin/env python3
+"""Host side of the firmware's serial command protocol.
+
+Talks to a RoboCan over its USB serial port, or to the native simulator
+on a pseudo-terminal, in COBS frames (include/command_protocol.h):
+list, upload, download and delete recordings, start and stop playback,
+and stream segments or G-code live with credit-based flow control.
+
+Segment files are CSV, one segment per line: dir1,dir2,pulses1,pulses2,ms
+(blank lines and # comments are skipped).
+
+  tools/robocan_link.py --port /dev/ttyUSB0 list
+  tools/robocan_link.py --port /dev/ttyUSB0 upload path.csv --save
+  tools/robocan_link.py --port /dev/ttyUSB0 stream path.csv
+  tools/robocan_link.py --port /dev/ttyUSB0 gcode part.nc
+  tools/robocan_link.py --sim .pio/build/native/program selftest
+
+--sim starts the simulator with --pty and connects to it; its summary is
+printed when the session ends.
+"""
+
+import argparse
+import os
+import select
+import struct
+import subprocess
+import sys
+import termios
+import time
+import tty
+import zlib
+
+CMD_PING, CMD_STATUS, CMD_LIST, CMD_UPLOAD, CMD_DOWNLOAD, CMD_DELETE = range(1, 7)
+CMD_PLAY, CMD_STOP, CMD_STREAM_BEGIN, CMD_STREAM_PUSH, CMD_STREAM_END, CMD_GCODE = range(7, 13)
+CMD_REPLY = 0x80
+EVT_STREAM = 0x53
+SEGMENTS_PER_FRAME = 8
+GCODE_FRAME_TEXT = 112          # program bytes per GCODE frame
+STATUS = ["OK", "BAD", "BUSY", "RANGE", "FULL", "UNKNOWN", "STATE"]
+STREAM_STATES = ["RUNNING", "DONE", "ABORTED"]
+GCODE_ERRORS = ["OK", "SYNTAX", "UNSUPPORTED", "RANGE", "NO_FEED", "NO_MOTION"]
+FLAGS = ["REC", "PLAY", "STOP", "ESTOP", "LINK", "REPLAY", "STREAM"]
+FLAG_PLAY = 0x0002
+
+SEGMENT = struct.Struct("<bbiiI")
+STATUS_REPLY = struct.Struct("<HiiHBBII")
+EVENT = struct.Struct("<BIIB")
+
+
+class LinkError(Exception):
+    pass
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code = 0
+    for b in data:
+        if b:
+            out.append(b)
+        if not b or len(out) - code == 0xFF:
+            out[code] = len(out) - code
+            code = len(out)
+            out.append(0)
+    out[code] = len(out) - code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        run = data[i]
+        i += 1
+        if run == 0 or i + run - 1 > len(data):
+            return None
+        out += data[i:i + run - 1]
+        i += run - 1
+        if run != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def frame(kind, payload):
+    body = bytes([kind]) + payload
+    return b"\0" + cobs_encode(body + struct.pack("<I", zlib.crc32(body))) + b"\0"
+
+
+def pack_segments(segs):
+    return b"".join(SEGMENT.pack(*s) for s in segs)
+
+
+def unpack_segments(data, n):
+    return [SEGMENT.unpack_from(data, i * SEGMENT.size) for i in range(n)]
+
+
+def read_segments(path):
+    segs = []
+    with open(path) as f:
+        for line in f:
+            line = line.split("#", 1)[0].strip()
+            if line:
+                segs.append(tuple(int(v) for v in line.split(",")))
+    return segs
+
+
+def write_segments(f, segs):
+    f.write("# dir1,dir2,pulses1,pulses2,ms\n")
+    for s in segs:
+        f.write(",".join(str(v) for v in s) + "\n")
+
+
+class Link:
+    """One open port: sends commands, matches replies, tracks stream events."""
+
+    def __init__(self, path, baud, verbose=False):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        speed = getattr(termios, "B%d" % baud, None)
+        if speed is not None:
+            attrs = termios.tcgetattr(self.fd)
+            attrs[4] = attrs[5] = speed
+            termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        termios.tcflush(self.fd, termios.TCIFLUSH)
+        self.verbose = verbose
+        self.rx = bytearray()
+        self.buf = bytearray()
+        self.in_frame = False
+        self.seq = 0
+        self.event = None          # last EVT_STREAM: credits, completed, underruns, state
+        self.noise = 0
+
+    def close(self):
+        os.close(self.fd)
+
+    def _frames(self, timeout):
+        """Read for up to timeout seconds; yield (type, payload) per good frame.
+
+        Bytes read past the frame a caller stops at stay in self.rx.
+        """
+        end = time.monotonic() + timeout
+        while True:
+            while self.rx:
+                b = self.rx.pop(0)
+                got = self._feed(b)
+                if got:
+                    yield got
+            left = end - time.monotonic()
+            if left <= 0:
+                return
+            if select.select([self.fd], [], [], left)[0]:
+                self.rx += os.read(self.fd, 4096)
+
+    def _feed(self, b):
+        # same split as the firmware's FrameReader: text outside frames
+        if not self.in_frame:
+            if b == 0:
+                self.in_frame, self.buf = True, bytearray()
+            elif self.verbose:
+                sys.stderr.write(chr(b))
+            return None
+        if b:
+            self.buf.append(b)
+            return None
+        if not self.buf:
+            return None
+        self.in_frame = False
+        raw = cobs_decode(bytes(self.buf))
+        if raw is None or len(raw) < 5 or \
+           struct.unpack("<I", raw[-4:])[0] != zlib.crc32(raw[:-4]):
+            self.noise += 1
+            return None
+        kind, payload = raw[0], raw[1:-4]
+        if kind == EVT_STREAM and len(payload) == EVENT.size:
+            self.event = EVENT.unpack(payload)
+        return kind, payload
+
+    def send(self, cmd, payload=b""):
+        self.seq = (self.seq + 1) & 0xFF
+        os.write(self.fd, frame(cmd, bytes([self.seq]) + payload))
+        return self.seq
+
+    def wait(self, cmd, seq, timeout=2.0):
+        for kind, payload in self._frames(timeout):
+            if kind == cmd | CMD_REPLY and len(payload) >= 2 and payload[0] == seq:
+                return payload[1], payload[2:]
+        raise LinkError("no reply to command 0x%02x" % cmd)
+
+    def call(self, cmd, payload=b"", ok=(0,), timeout=2.0):
+        status, data = self.wait(cmd, self.send(cmd, payload), timeout)
+        if status not in ok:
+            raise LinkError("command 0x%02x: %s" % (cmd, STATUS[status] if status < len(STATUS) else status))
+        return status, data
+
+    def pump(self, timeout):
+        for _ in self._frames(timeout):
+            pass
+
+    # commands
+
+    def ping(self):
+        _, d = self.call(CMD_PING)
+        version, max_segs, queue, per_frame, moves = struct.unpack("<BHBBB", d[:6])
+        return {"version": version, "max_segments": max_segs, "queue": queue,
+                "per_frame": per_frame, "move_queue": moves}
+
+    def status(self):
+        _, d = self.call(CMD_STATUS)
+        flags, p1, p2, segs, queued, credits, done, under = STATUS_REPLY.unpack(d[:STATUS_REPLY.size])
+        return {"flags": flags, "pos1": p1, "pos2": p2, "segments": segs, "queued": queued,
+                "credits": credits, "completed": done, "underruns": under}
+
+    def list(self):
+        _, d = self.call(CMD_LIST)
+        ram, ram_stamp, stored, stored_stamp = struct.unpack("<HIHI", d[:12])
+        return [("ram", ram, ram_stamp), ("flash", stored, stored_stamp)]
+
+    def upload(self, segs, save=False):
+        offset = 0
+        while True:
+            chunk = segs[offset:offset + SEGMENTS_PER_FRAME]
+            head = struct.pack("<BHHB", 1 if save else 0, len(segs), offset, len(chunk))
+            # saving writes flash after the last chunk: allow for it
+            self.call(CMD_UPLOAD, head + pack_segments(chunk), timeout=5.0)
+            offset += len(chunk)
+            if offset >= len(segs):
+                return
+
+    def download(self):
+        segs, total = [], None
+        while total is None or len(segs) < total:
+            _, d = self.call(CMD_DOWNLOAD, struct.pack("<HB", len(segs), SEGMENTS_PER_FRAME))
+            total, _, n = struct.unpack("<HHB", d[:5])
+            if not n and len(segs) < total:
+                raise LinkError("download stalled at %d of %d" % (len(segs), total))
+            segs += unpack_segments(d[5:], n)
+        return segs
+
+    def delete(self):
+        self.call(CMD_DELETE)
+
+    def play(self, reverse=False):
+        self.call(CMD_PLAY, bytes([1 if reverse else 0]))
+
+    def stop(self):
+        self.call(CMD_STOP)
+
+    def wait_idle(self, timeout):
+        end = time.monotonic() + timeout
+        while time.monotonic() < end:
+            st = self.status()
+            if not st["flags"] & FLAG_PLAY:
+                return st
+            self.pump(0.1)
+        raise LinkError("still running after %.0f s" % timeout)
+
+    def stream(self, segs, window=None, timeout=10.0):
+        """Send segments as credits allow; returns the final stream event.
+
+        One push is in flight at a time, so the credits in its reply are
+        exact; events that arrive while it is out are older than the push
+        and only count once it is answered.
+        """
+        _, d = self.call(CMD_STREAM_BEGIN)
+        credits = d[0]
+        self.event = None
+        sent = 0
+        while sent < len(segs):
+            allowed = min(credits, SEGMENTS_PER_FRAME, len(segs) - sent)
+            if window is not None:
+                done = self.event[1] if self.event else 0
+                allowed = min(allowed, window - (sent - done))
+            if allowed <= 0:
+                credits = self._next_credits(timeout)
+                continue
+            status, d = self.call(CMD_STREAM_PUSH, bytes([allowed]) + pack_segments(segs[sent:sent + allowed]),
+                                  ok=(0, 4))
+            credits = d[0]
+            if status == 0:
+                sent += allowed
+        self.call(CMD_STREAM_END)
+        end = time.monotonic() + timeout + sum(s[4] for s in segs) / 1000.0
+        while not self.event or self.event[3] == 0:
+            if time.monotonic() > end:
+                raise LinkError("stream did not finish")
+            self.pump(0.1)
+        return self.event
+
+    def gcode(self, text, timeout=10.0):
+        """Stream G-code as move credits allow; returns the final event.
+
+        Whole lines are packed into frames, each line end costing one
+        credit; a line longer than a frame goes in pieces, which cost
+        nothing until its end. The first bad line reported stops the run.
+        """
+        data = text.encode("ascii")
+        if not data.endswith(b"\n"):
+            data += b"\n"
+        _, d = self.call(CMD_STREAM_BEGIN, bytes([1]))
+        credits = d[0]
+        self.event = None
+        pos = 0
+        while pos < len(data):
+            limit = pos + GCODE_FRAME_TEXT
+            end, lines = pos, 0
+            while lines < credits:
+                nl = data.find(b"\n", end, limit)
+                if nl < 0:
+                    break
+                end, lines = nl + 1, lines + 1
+            if end == pos:
+                if data.find(b"\n", pos, limit) >= 0:
+                    credits = self._next_credits(timeout)
+                    continue
+                end = limit
+            status, d = self.call(CMD_GCODE, data[pos:end], ok=(0, 4))
+            credits = d[0]
+            if status != 0:
+                continue
+            pos = end
+            if d[1]:
+                line = struct.unpack("<I", d[2:6])[0]
+                self.call(CMD_STOP, ok=(0, 6))
+                self._finish(timeout)
+                raise LinkError("line %d: %s" % (line, GCODE_ERRORS[d[1]] if d[1] < len(GCODE_ERRORS) else d[1]))
+        self.call(CMD_STREAM_END)
+        return self._finish(timeout)
+
+    def _next_credits(self, timeout):
+        before = self.event
+        for _ in self._frames(timeout):
+            if self.event is not before:
+                break
+        if self.event is before:
+            raise LinkError("no credit after %.0f s" % timeout)
+        if self.event[3] != 0:
+            raise LinkError("stream ended early: %s" % STREAM_STATES[self.event[3]])
+        return self.event[0]
+
+    # moves and dwells have no length the host knows: wait while they progress
+    def _finish(self, timeout):
+        end = time.monotonic() + timeout
+        while not self.event or self.event[3] == 0:
+            if time.monotonic() > end:
+                raise LinkError("stream did not finish")
+            before = self.event
+            self.pump(0.1)
+            if self.event is not before:
+                end = time.monotonic() + timeout
+        return self.event
+
+
+def start_sim(program):
+    proc = subprocess.Popen([program, "--pty", "-t", "0"], stdout=subprocess.PIPE,
+                            universal_newlines=True)
+    line = proc.stdout.readline().strip()
+    if not line.startswith("SIM pty="):
+        proc.kill()
+        raise LinkError("simulator did not report a pty: %r" % line)
+    return proc, line[len("SIM pty="):]
+
+
+def stop_sim(proc):
+    proc.terminate()
+    out, _ = proc.communicate(timeout=10)
+    sys.stderr.write(out)
+
+
+# a small square-ish path: drive, spin, dwell, unequal rates
+def test_path(n):
+    base = [(1, 1, 120, 120, 100), (1, -1, 80, 80, 80), (0, 0, 0, 0, 30),
+            (1, 1, 150, 60, 120), (-1, -1, 40, 40, 50)]
+    return [base[i % len(base)] for i in range(n)]
+
+
+def net(segs):
+    return (sum(s[0] * s[2] for s in segs), sum(s[1] * s[3] for s in segs))
+
+
+def selftest(link, args):
+    failures = []
+
+    def check(name, cond, detail=""):
+        print("%-28s %s %s" % (name, "PASS" if cond else "FAIL", detail))
+        if not cond:
+            failures.append(name)
+
+    info = link.ping()
+    check("ping", info["version"] == 2, str(info))
+
+    segs = test_path(21)              # three upload frames
+    link.upload(segs, save=True)
+    rows = link.list()
+    check("upload+list", rows[0][1] == len(segs) and rows[1][1] == len(segs) and
+          rows[0][2] == rows[1][2], str(rows))
+    back = link.download()
+    check("download", back == segs, "%d segments" % len(back))
+
+    p0 = link.status()
+    link.play()
+    p1 = link.wait_idle(30)
+    n1, n2 = net(segs)
+    check("play", (p1["pos1"] - p0["pos1"], p1["pos2"] - p0["pos2"]) == (n1, n2),
+          "moved %d,%d want %d,%d" % (p1["pos1"] - p0["pos1"], p1["pos2"] - p0["pos2"], n1, n2))
+
+    live = test_path(60)
+    t0 = time.monotonic()
+    ev = link.stream(live, window=args.window)
+    wall = time.monotonic() - t0
+    p2 = link.status()
+    n1, n2 = net(live)
+    check("stream", STREAM_STATES[ev[3]] == "DONE" and ev[1] == len(live) and
+          (p2["pos1"] - p1["pos1"], p2["pos2"] - p1["pos2"]) == (n1, n2),
+          "%d segments %.2fs underruns %d" % (ev[1], wall, ev[2]))
+    check("stream never starved", ev[2] == 0, "underruns %d" % ev[2])
+
+    status, _ = link.call(CMD_STREAM_PUSH, bytes([1]) + pack_segments(live[:1]), ok=(0, 6))
+    check("push without stream", status == 6, STATUS[status])
+
+    # absolute from the axis origin, back there relatively
+    prog = "G0 X0 Y0\nM17\nG1 X10 Y10 F1200 (out)\nG4 P100\nG91\nG1 X-10 Y-10\nM18\n"
+    ev = link.gcode(prog)
+    p3 = link.status()
+    check("gcode", STREAM_STATES[ev[3]] == "DONE" and ev[1] == 6 and
+          (p3["pos1"], p3["pos2"]) == (0, 0),
+          "%d moves, at %d,%d" % (ev[1], p3["pos1"], p3["pos2"]))
+    try:
+        link.gcode("G1 X5 F600\nG7\nG1 X0\n")
+        check("gcode error stops", False, "no error reported")
+    except LinkError as e:
+        check("gcode error stops", "line 2: UNSUPPORTED" in str(e) and
+              not link.status()["flags"] & FLAG_PLAY, str(e))
+
+    link.delete()
+    rows = link.list()
+    check("delete", rows[0][1] == 0 and rows[1][1] == 0, str(rows))
+    return 1 if failures else 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    where = ap.add_mutually_exclusive_group(required=True)
+    where.add_argument("--port", help="serial port or pty path")
+    where.add_argument("--sim", help="native simulator binary to start on a pty")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("-v", "--verbose", action="store_true", help="echo the device's text output")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+    sub.add_parser("ping")
+    sub.add_parser("status")
+    sub.add_parser("list")
+    p = sub.add_parser("upload")
+    p.add_argument("file")
+    p.add_argument("--save", action="store_true", help="also write it to flash")
+    p = sub.add_parser("download")
+    p.add_argument("file", nargs="?", help="CSV to write, default stdout")
+    sub.add_parser("delete")
+    p = sub.add_parser("play")
+    p.add_argument("--reverse", action="store_true")
+    sub.add_parser("stop")
+    p = sub.add_parser("stream")
+    p.add_argument("file")
+    p.add_argument("--window", type=int, help="segments in flight, default: all credits")
+    p = sub.add_parser("gcode")
+    p.add_argument("file")
+    p = sub.add_parser("selftest")
+    p.add_argument("--window", type=int)
+    args = ap.parse_args()
+
+    proc = None
+    try:
+        port = args.port
+        if args.sim:
+            proc, port = start_sim(args.sim)
+        link = Link(port, args.baud, args.verbose)
+        rc = 0
+        if args.cmd == "ping":
+            print(link.ping())
+        elif args.cmd == "status":
+            st = link.status()
+            st["flags"] = "|".join(n for b, n in enumerate(FLAGS) if st["flags"] & (1 << b))
+            print(st)
+        elif args.cmd == "list":
+            for name, count, stamp in link.list():
+                print("%-5s %3d segments  stamp %08x" % (name, count, stamp))
+        elif args.cmd == "upload":
+            segs = read_segments(args.file)
+            link.upload(segs, args.save)
+            print("uploaded %d segments" % len(segs))
+        elif args.cmd == "download":
+            segs = link.download()
+            if args.file:
+                with open(args.file, "w") as f:
+                    write_segments(f, segs)
+            else:
+                write_segments(sys.stdout, segs)
+        elif args.cmd == "delete":
+            link.delete()
+        elif args.cmd == "play":
+            link.play(args.reverse)
+        elif args.cmd == "stop":
+            link.stop()
+        elif args.cmd == "stream":
+            segs = read_segments(args.file)
+            t0 = time.monotonic()
+            ev = link.stream(segs, window=args.window)
+            print("%s: %d segments in %.2f s, %d underruns" %
+                  (STREAM_STATES[ev[3]], ev[1], time.monotonic() - t0, ev[2]))
+            rc = 0 if ev[3] == 1 else 1
+        elif args.cmd == "gcode":
+            with open(args.file) as f:
+                text = f.read()
+            t0 = time.monotonic()
+            ev = link.gcode(text)
+            print("%s: %d moves in %.2f s, %d underruns" %
+                  (STREAM_STATES[ev[3]], ev[1], time.monotonic() - t0, ev[2]))
+            rc = 0 if ev[3] == 1 else 1
+        elif args.cmd == "selftest":
+            rc = selftest(link, args)
+        link.close()
+    except LinkError as e:
+        sys.stderr.write("error: %s\n" % e)
+        rc = 2
+    finally:
+        if proc:
+            stop_sim(proc)
+    sys.exit(rc)
+
+
+if __name__ == "__main__":
+    main()
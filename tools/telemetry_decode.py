@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Decode the firmware's binary telemetry stream into CSV.
+
+Reads raw serial bytes (a capture file, stdin, or a port with pyserial),
+splits them at 0x00 delimiters, undoes COBS, checks the CRC-32 and
+unpacks telemetry frames (type 0x54). Anything else on the line, such as
+the text log, fails the check and is counted as noise.
+
+  tools/telemetry_decode.py capture.bin > samples.csv
+  tools/telemetry_decode.py --port /dev/ttyUSB0 --baud 921600
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+FRAME_SAMPLE = 0x54
+SAMPLE = struct.Struct("<II ii II II II I i BB H")   # telemetry.h, packTelemetry()
+FLAGS = ["REC", "PLAY", "STOP", "ESTOP", "LINK", "REPLAY", "STREAM"]
+COLUMNS = ["seq", "t_us", "pos1", "pos2", "rate1", "rate2", "step_us1", "step_us2",
+           "idle_us1", "idle_us2", "loop_us", "feed", "dir", "enable", "flags"]
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        run = data[i]
+        i += 1
+        if run == 0 or i + run - 1 > len(data):
+            return None
+        out += data[i:i + run - 1]
+        i += run - 1
+        if run != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def frames(chunks):
+    """Yield (type, payload) for every frame that passes its CRC; count the rest."""
+    buf = bytearray()
+    for chunk in chunks:
+        buf += chunk
+        while True:
+            end = buf.find(0)
+            if end < 0:
+                break
+            body, buf = bytes(buf[:end]), buf[end + 1:]
+            if not body:
+                continue
+            raw = cobs_decode(body)
+            if raw is None or len(raw) < 5 or \
+               struct.unpack("<I", raw[-4:])[0] != zlib.crc32(raw[:-4]):
+                stats["noise"] += 1
+                continue
+            yield raw[0], raw[1:-4]
+
+
+def rate(plan_us, forward):
+    if not plan_us:
+        return 0.0
+    return (1e6 if forward else -1e6) / plan_us
+
+
+def row(payload):
+    (seq, t, p1, p2, plan1, plan2, step1, step2, last1, last2,
+     loop_us, feed, dirs, enable, flags) = SAMPLE.unpack(payload)
+    return [seq, t, p1, p2,
+            "%.1f" % rate(plan1, dirs & 1), "%.1f" % rate(plan2, dirs & 2),
+            step1, step2, (t - last1) & 0xFFFFFFFF, (t - last2) & 0xFFFFFFFF,
+            loop_us, "%.4f" % (feed / 65536.0), dirs, enable,
+            "|".join(n for b, n in enumerate(FLAGS) if flags & (1 << b))]
+
+
+def source(args):
+    if args.port:
+        import serial  # pyserial, only needed for a live port
+        port = serial.Serial(args.port, args.baud, timeout=0.5)
+        while True:
+            yield port.read(4096)
+    f = sys.stdin.buffer if args.file in (None, "-") else open(args.file, "rb")
+    while True:
+        chunk = f.read(65536)
+        if not chunk:
+            return
+        yield chunk
+
+
+stats = {"frames": 0, "noise": 0, "gaps": 0}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("file", nargs="?", help="capture file, - or omitted for stdin")
+    ap.add_argument("--port", help="serial port to read live (needs pyserial)")
+    ap.add_argument("--baud", type=int, default=115200)
+    args = ap.parse_args()
+
+    print(",".join(COLUMNS))
+    last = None
+    try:
+        for kind, payload in frames(source(args)):
+            if kind != FRAME_SAMPLE or len(payload) != SAMPLE.size:
+                continue
+            r = row(payload)
+            if last is not None and r[0] != (last + 1) & 0xFFFFFFFF:
+                stats["gaps"] += 1
+            last = r[0]
+            stats["frames"] += 1
+            print(",".join(str(v) for v in r))
+    except KeyboardInterrupt:
+        pass
+    sys.stderr.write("frames=%(frames)d seq_gaps=%(gaps)d noise=%(noise)d\n" % stats)
+
+
+if __name__ == "__main__":
+    main()